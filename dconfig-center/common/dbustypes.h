@@ -0,0 +1,53 @@
+// SPDX-FileCopyrightText: 2026 Uniontech Software Technology Co.,Ltd.
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#pragma once
+
+#include <QString>
+#include <QList>
+#include <QMap>
+#include <QVariantMap>
+#include <QMetaType>
+#include <QDBusArgument>
+#include <QDBusMetaType>
+
+// 配置描述文件标识，对应D-Bus类型(sss)
+struct ConfigResourceId
+{
+    QString appid;
+    QString name;
+    QString subpath;
+};
+using ConfigResourceIdList = QList<ConfigResourceId>;
+
+// 配置项名称及其描述信息，对应D-Bus类型a{sa{sv}}，
+// 描述信息包含name、description、value、isDefaultValue、visibility、permissions及flags
+using ConfigKeyDescriptions = QMap<QString, QVariantMap>;
+
+Q_DECLARE_METATYPE(ConfigResourceId)
+Q_DECLARE_METATYPE(ConfigResourceIdList)
+Q_DECLARE_METATYPE(ConfigKeyDescriptions)
+
+inline QDBusArgument &operator<<(QDBusArgument &argument, const ConfigResourceId &id)
+{
+    argument.beginStructure();
+    argument << id.appid << id.name << id.subpath;
+    argument.endStructure();
+    return argument;
+}
+
+inline const QDBusArgument &operator>>(const QDBusArgument &argument, ConfigResourceId &id)
+{
+    argument.beginStructure();
+    argument >> id.appid >> id.name >> id.subpath;
+    argument.endStructure();
+    return argument;
+}
+
+inline void registerConfigDBusMetaTypes()
+{
+    qDBusRegisterMetaType<ConfigResourceId>();
+    qDBusRegisterMetaType<ConfigResourceIdList>();
+    qDBusRegisterMetaType<ConfigKeyDescriptions>();
+}
@@ -10,12 +10,16 @@
 #include <QDir>
 #include <QDirIterator>
 #include <QDBusArgument>
+#include <QDBusConnection>
+#include <QDBusMessage>
+#include <QDBusReply>
 #include <QJsonDocument>
 #include <QJsonValue>
 #include <DConfigFile>
 #include <dstandardpaths.h>
 #include <QCoreApplication>
 #include <QTranslator>
+#include <optional>
 
 using ResourceId = QString;
 using ResourcePath = QString;
@@ -49,15 +53,39 @@ enum ConfigType {
     KeyType = 0x40,
 };
 
+// 查询服务维护的配置目录，服务未运行、不支持或使用自定义前缀时返回空，由调用者遍历配置目录
+static std::optional<QStringList> catalogFromService(const QString &method, const QVariantList &arguments, const QString &localPrefix)
+{
+    static bool unsupported = false;
+    if (!localPrefix.isEmpty() || unsupported)
+        return std::nullopt;
+
+    auto message = QDBusMessage::createMethodCall("org.desktopspec.ConfigManager", "/",
+                                                  "org.desktopspec.ConfigManager", method);
+    message.setArguments(arguments);
+    message.setAutoStartService(false);
+    const QDBusReply<QStringList> reply = QDBusConnection::systemBus().call(message);
+    if (!reply.isValid()) {
+        if (reply.error().type() == QDBusError::UnknownMethod)
+            unsupported = true;
+        return std::nullopt;
+    }
+    return reply.value();
+}
+
 static AppList applications(const QString &localPrefix = QString())
 {
     AppList result;
     result << NoAppId;
 
+    if (const auto &apps = catalogFromService("listApps", {}, localPrefix)) {
+        result << *apps;
+        return result;
+    }
+
     result.reserve(50);
 
-    // TODO calling service interface to get app list,
-    // and now we can't distingush between `subpath` or `appid` for common configuration.
+    // we can't distingush between `subpath` or `appid` for common configuration.
     using namespace Dtk::Core;
     QStringList appDirs = DConfigMeta::genericMetaDirs(localPrefix);
     const QStringList filterDirs {"overrides"};
@@ -104,6 +132,9 @@ static ResourceList resourcePathsForApp(const QString &appid, const QString &loc
 
 static ResourceList resourcesForApp(const QString &appid, const QString &localPrefix = QString())
 {
+    if (const auto &resources = catalogFromService("listResources", {appid}, localPrefix))
+        return *resources;
+
     QSet<ResourceId> result;
     result.reserve(50);
     for (auto item : resourcePathsForApp(appid, localPrefix)) {
@@ -117,6 +148,9 @@ static ResourceList resourcesForApp(const QString &appid, const QString &localPr
 
 static ResourceList resourcesForAllApp(const QString &localPrefix = QString())
 {
+    if (const auto &resources = catalogFromService("listResources", {NoAppId}, localPrefix))
+        return *resources;
+
     QSet<ResourceId> result;
     result.reserve(50);
     using namespace Dtk::Core;
@@ -133,6 +167,9 @@ static ResourceList resourcesForAllApp(const QString &localPrefix = QString())
 
 static SubpathList subpathsForResource(const AppId &appid, const ResourceId &resourceId, const QString &localPrefix = QString())
 {
+    if (const auto &subpaths = catalogFromService("listSubpaths", {appid, resourceId}, localPrefix))
+        return *subpaths;
+
     SubpathList result;
     for (auto item : resourcePathsForApp(appid, localPrefix)) {
         QDir resourceDir(QFileInfo(item).absoluteDir());
@@ -7,12 +7,47 @@
 #include "configmanager_interface.h"
 #include "manager_interface.h"
 #include "helper.hpp"
+#include "dbustypes.h"
 
 #include <DConfigFile>
 
+__attribute__((constructor)) // 在库被加载时就执行此函数
+static void registerMetaType()
+{
+    registerConfigDBusMetaTypes();
+}
+
 static constexpr char const *DSG_CONFIG = "org.desktopspec.ConfigManager";
 static constexpr char const *DSG_CONFIG_MANAGER = "org.desktopspec.ConfigManager";
 
+// 逐个配置项获取描述信息，与服务的describe返回内容一致
+static QMap<QString, QVariantMap> describeByKeys(ConfigGetter *getter, const QString &locale)
+{
+    QMap<QString, QVariantMap> result;
+    const auto &values = getter->allValues();
+    for (const auto &key : getter->keyList()) {
+        QVariantMap info;
+        auto name = getter->displayName(key, locale);
+        if (name.isEmpty() && !locale.isEmpty())
+            name = getter->displayName(key, QString());
+        info.insert(QStringLiteral("name"), name);
+
+        auto description = getter->description(key, locale);
+        if (description.isEmpty() && !locale.isEmpty())
+            description = getter->description(key, QString());
+        info.insert(QStringLiteral("description"), description);
+
+        if (values.contains(key))
+            info.insert(QStringLiteral("value"), values.value(key));
+        info.insert(QStringLiteral("isDefaultValue"), getter->isDefaultValue(key));
+        info.insert(QStringLiteral("visibility"), getter->visibility(key));
+        info.insert(QStringLiteral("permissions"), getter->permissions(key));
+        info.insert(QStringLiteral("flags"), getter->flags(key));
+        result.insert(key, info);
+    }
+    return result;
+}
+
 class DBusHandler : public ConfigGetter {
 
 public:
@@ -58,6 +93,80 @@ public:
         }
     }
 
+    QVariantMap values(const QStringList &keys) const override
+    {
+        auto reply = manager->values(keys);
+        reply.waitForFinished();
+        if (reply.isError()) {
+            // 服务不支持批量接口时逐个获取
+            qWarning() << "values error, fallback to get value one by one, error message:" << reply.error().message();
+            QVariantMap result;
+            for (const auto &key : keys)
+                result.insert(key, value(key));
+            return result;
+        }
+        return decodeValues(reply.value());
+    }
+
+    QVariantMap allValues() const override
+    {
+        auto reply = manager->allValues();
+        reply.waitForFinished();
+        if (reply.isError()) {
+            qWarning() << "allValues error, fallback to get value one by one, error message:" << reply.error().message();
+            return values(keyList());
+        }
+        return decodeValues(reply.value());
+    }
+
+    void setValues(const QVariantMap &values) override
+    {
+        QVariantMap dbusValues;
+        for (auto iter = values.cbegin(); iter != values.cend(); ++iter)
+            dbusValues.insert(iter.key(), QVariant::fromValue(QDBusVariant(iter.value())));
+
+        auto reply = manager->setValues(dbusValues);
+        reply.waitForFinished();
+        if (reply.isError()) {
+            qWarning() << "setValues error, error message:" << reply.error().message();
+            if (reply.error().type() == QDBusError::UnknownMethod) {
+                for (auto iter = values.cbegin(); iter != values.cend(); ++iter)
+                    setValue(iter.key(), iter.value());
+            }
+        }
+    }
+
+    void resetAll() override
+    {
+        auto reply = manager->resetAll();
+        reply.waitForFinished();
+        if (reply.isError()) {
+            qWarning() << "resetAll error, error message:" << reply.error().message();
+            if (reply.error().type() == QDBusError::UnknownMethod) {
+                for (const auto &key : keyList())
+                    reset(key);
+            }
+        }
+    }
+
+    QMap<QString, QVariantMap> describe(const QString &locale) override
+    {
+        auto reply = manager->describe(locale);
+        reply.waitForFinished();
+        if (reply.isError()) {
+            qWarning() << "describe error, fallback to get information one by one, error message:" << reply.error().message();
+            return describeByKeys(this, locale);
+        }
+
+        auto result = reply.value();
+        for (auto iter = result.begin(); iter != result.end(); ++iter) {
+            auto value = iter.value().find(QStringLiteral("value"));
+            if (value != iter.value().end())
+                value.value() = decodeQDBusArgument(value.value());
+        }
+        return result;
+    }
+
     QString permissions(const QString &key) const override
     {
         return manager->permissions(key);
@@ -114,11 +223,16 @@ public:
             return nullptr;
         }
 
-        std::unique_ptr<DSGConfigManager> config(new DSGConfigManager(DSG_CONFIG_MANAGER, dbus_path.path(),
+        return createManager(dbus_path);
+    }
+
+    DSGConfigManager *createManager(const QDBusObjectPath &path)
+    {
+        std::unique_ptr<DSGConfigManager> config(new DSGConfigManager(DSG_CONFIG_MANAGER, path.path(),
                                                                      QDBusConnection::systemBus()));
         if (!config->isValid()) {
-            qWarning() << QString("can't not get dbus handler for appid=%1, resource=%2, subpath=%3.").arg(appid, fileName, subpath)
-                       << dbus_reply.error().message();
+            qWarning() << QString("can't not get dbus handler for appid=%1, resource=%2, subpath=%3.").arg(owner->appid, owner->fileName, owner->subpath)
+                       << config->lastError().message();
             return nullptr;
         }
         manager.reset(config.release());
@@ -127,6 +241,23 @@ public:
         return manager.get();
     }
 
+    // 一次调用获取多个连接路径，失败的配置对应的路径为"/"
+    static QDBusPendingReply<QList<QDBusObjectPath>> acquireManagers(const int uid, const ConfigResourceIdList &resources)
+    {
+        DSGConfig dsg_config(DSG_CONFIG, "/", QDBusConnection::systemBus());
+        auto reply = dsg_config.acquireManagers(static_cast<uint>(uid), resources);
+        reply.waitForFinished();
+        return reply;
+    }
+
+    static QVariantMap decodeValues(const QVariantMap &values)
+    {
+        QVariantMap result;
+        for (auto iter = values.cbegin(); iter != values.cend(); ++iter)
+            result.insert(iter.key(), decodeQDBusArgument(iter.value()));
+        return result;
+    }
+
     static bool isServiceRegistered()
     {
         return QDBusConnection::systemBus().interface()->isServiceRegistered(DSG_CONFIG);
@@ -187,6 +318,36 @@ public:
         setValue(key, v);
     }
 
+    QVariantMap values(const QStringList &keys) const override
+    {
+        QVariantMap result;
+        for (const auto &key : keys)
+            result.insert(key, value(key));
+        return result;
+    }
+
+    QVariantMap allValues() const override
+    {
+        return values(keyList());
+    }
+
+    void setValues(const QVariantMap &values) override
+    {
+        for (auto iter = values.cbegin(); iter != values.cend(); ++iter)
+            setValue(iter.key(), iter.value());
+    }
+
+    void resetAll() override
+    {
+        for (const auto &key : keyList())
+            reset(key);
+    }
+
+    QMap<QString, QVariantMap> describe(const QString &locale) override
+    {
+        return describeByKeys(this, locale);
+    }
+
     QString permissions(const QString &key) const override
     {
         return manager->meta()->permissions(key) == DTK_CORE_NAMESPACE::DConfigFile::ReadWrite ? QString("readwrite") : QString("readonly");
@@ -315,6 +476,62 @@ ConfigGetter* ValueHandler::createManager()
     return nullptr;
 }
 
+/*!
+ \brief 批量创建多个配置的连接，相同用户的配置通过一次D-Bus调用获取
+ 服务不支持批量获取时，退化为逐个调用createManager。
+ \return 与handlers一一对应，获取失败的为nullptr，由调用者释放
+ */
+QList<ConfigGetter *> ValueHandler::createManagers(const QList<ValueHandler *> &handlers)
+{
+    QList<ConfigGetter *> managers;
+    managers.reserve(handlers.size());
+    for (int i = 0; i < handlers.size(); ++i)
+        managers << nullptr;
+
+    if (!DBusHandler::isServiceRegistered()) {
+        qWarning() << "get value handlers error, the service isn't registered.";
+        return managers;
+    }
+
+    QMap<int, QList<int>> indexesByUid;
+    for (int i = 0; i < handlers.size(); ++i)
+        indexesByUid[handlers[i]->getUid()] << i;
+
+    for (auto iter = indexesByUid.cbegin(); iter != indexesByUid.cend(); ++iter) {
+        const auto &indexes = iter.value();
+        ConfigResourceIdList resources;
+        resources.reserve(indexes.size());
+        for (auto index : indexes) {
+            const auto handler = handlers[index];
+            resources << ConfigResourceId{handler->appid, handler->fileName, handler->subpath};
+        }
+
+        const auto &reply = DBusHandler::acquireManagers(iter.key(), resources);
+        if (reply.isError() || reply.value().size() != indexes.size()) {
+            qWarning() << "acquireManagers error, fallback to acquire one by one, error message:" << reply.error().message();
+            for (auto index : indexes)
+                managers[index] = handlers[index]->createManager();
+            continue;
+        }
+
+        const auto &paths = reply.value();
+        for (int i = 0; i < indexes.size(); ++i) {
+            const auto handler = handlers[indexes[i]];
+            if (paths[i].path() == QLatin1String("/")) {
+                qWarning() << QString("get value handler error for appid=%1, resource=%2, subpath=%3.").arg(handler->appid, handler->fileName, handler->subpath);
+                continue;
+            }
+            auto tmp = new DBusHandler(handler);
+            if (tmp->createManager(paths[i])) {
+                managers[indexes[i]] = tmp;
+            } else {
+                delete tmp;
+            }
+        }
+    }
+    return managers;
+}
+
 int ValueHandler::getUid() const
 {
     if (uid == -1)
@@ -16,6 +16,11 @@ public:
     virtual void setValue(const QString &key, const QVariant &value) = 0;
     virtual QVariant value(const QString &key) const = 0;
     virtual void reset(const QString &key) = 0;
+    virtual QVariantMap values(const QStringList &keys) const = 0;
+    virtual QVariantMap allValues() const = 0;
+    virtual void setValues(const QVariantMap &values) = 0;
+    virtual void resetAll() = 0;
+    virtual QMap<QString, QVariantMap> describe(const QString &locale) = 0;
     virtual QString permissions(const QString &key) const = 0;
     virtual QString visibility(const QString &key) const = 0;
     virtual QString displayName(const QString &key, const QString &locale) = 0;
@@ -38,6 +43,7 @@ public:
     static int currentUid();
 
     ConfigGetter *createManager();
+    static QList<ConfigGetter *> createManagers(const QList<ValueHandler *> &handlers);
     int getUid() const;
 
 Q_SIGNALS:
@@ -7,30 +7,339 @@
 #include <QFile>
 #include <QQueue>
 #include <QString>
+#include <QHash>
+#include <QVector>
+#include <QDebug>
+#include <QMetaType>
+#include <QReadWriteLock>
 #include <functional>
-#include <QRegularExpression>
+#include <tuple>
 #include <DStandardPaths>
 #include <QLoggingCategory>
 #include "helper.hpp"
 
 Q_DECLARE_LOGGING_CATEGORY(cfLog);
 
-// /appid/filename/subpath/userid
-using ConnKey = QString;
-// /appid/filename/subpath
-using ResourceKey = QString;
-// /filename/subpath
-using GenericResourceKey = QString;
 using ConnServiceName = QString;
 using ConnRefCount = int;
-// user: u-${ConnKey}, global: g-${ResourceKey}
-using ConfigCacheKey = QString;
 static constexpr int TestUid = 0U;
 static const QString VirtualInterAppId = "_";
 
+#if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
+using ConfigKeyHash = size_t;
+#else
+using ConfigKeyHash = uint;
+#endif
+
+/*!
+ \brief 资源键使用的字符串驻留表
+ 将appid、配置名称及子目录映射为整型id，键的构造、比较及哈希只需处理id，空字符串固定为0。
+ 资源及其配置文件通过ref持有使用的id，没有持有者的字符串（如获取失败的配置）由sweep释放，
+ id不会被重新分配，已释放的id不会与新的字符串混淆。
+ */
+class ConfigKeyAtoms
+{
+public:
+    static quint32 intern(const QString &value)
+    {
+        if (value.isEmpty())
+            return 0;
+
+        auto &atoms = instance();
+        {
+            QReadLocker locker(&atoms.lock);
+            auto iter = atoms.ids.constFind(value);
+            if (iter != atoms.ids.constEnd())
+                return iter.value();
+        }
+        QWriteLocker locker(&atoms.lock);
+        auto iter = atoms.ids.constFind(value);
+        if (iter != atoms.ids.constEnd())
+            return iter.value();
+
+        const quint32 id = atoms.nextId++;
+        atoms.ids.insert(value, id);
+        atoms.atoms.insert(id, Atom{value, 0});
+        return id;
+    }
+    // 只查找，不插入
+    static bool find(const QString &value, quint32 *id)
+    {
+        if (value.isEmpty()) {
+            *id = 0;
+            return true;
+        }
+        auto &atoms = instance();
+        QReadLocker locker(&atoms.lock);
+        auto iter = atoms.ids.constFind(value);
+        if (iter == atoms.ids.constEnd())
+            return false;
+
+        *id = iter.value();
+        return true;
+    }
+    static QString value(const quint32 id)
+    {
+        auto &atoms = instance();
+        QReadLocker locker(&atoms.lock);
+        return atoms.atoms.value(id).value;
+    }
+    static void ref(const quint32 id)
+    {
+        if (id == 0)
+            return;
+
+        auto &atoms = instance();
+        QWriteLocker locker(&atoms.lock);
+        auto iter = atoms.atoms.find(id);
+        if (iter != atoms.atoms.end())
+            ++iter->refs;
+    }
+    static void deref(const quint32 id)
+    {
+        if (id == 0)
+            return;
+
+        auto &atoms = instance();
+        QWriteLocker locker(&atoms.lock);
+        auto iter = atoms.atoms.find(id);
+        if (iter != atoms.atoms.end() && iter->refs > 0)
+            --iter->refs;
+    }
+    // 释放没有持有者的字符串，只在事件循环中调用，调用者不能持有未ref的id
+    static int sweep()
+    {
+        auto &atoms = instance();
+        QWriteLocker locker(&atoms.lock);
+        int count = 0;
+        for (auto iter = atoms.atoms.begin(); iter != atoms.atoms.end();) {
+            if (iter->refs > 0) {
+                ++iter;
+                continue;
+            }
+            atoms.ids.remove(iter->value);
+            iter = atoms.atoms.erase(iter);
+            ++count;
+        }
+        return count;
+    }
+    static int size()
+    {
+        auto &atoms = instance();
+        QReadLocker locker(&atoms.lock);
+        return atoms.atoms.size();
+    }
+
+private:
+    struct Atom {
+        QString value;
+        int refs = 0;
+    };
+    struct Table {
+        QReadWriteLock lock;
+        QHash<QString, quint32> ids;
+        QHash<quint32, Atom> atoms;
+        quint32 nextId = 1;
+    };
+    static Table &instance()
+    {
+        static Table table;
+        return table;
+    }
+};
+
+inline constexpr ConfigKeyHash combineConfigKeyHash(ConfigKeyHash seed, const quint32 value)
+{
+    return seed ^ (value + 0x9e3779b9U + (seed << 6) + (seed >> 2));
+}
+
+// /filename/subpath
+struct GenericResourceKey
+{
+    GenericResourceKey() = default;
+    GenericResourceKey(const quint32 name, const quint32 subpath)
+        : name(name)
+        , subpath(subpath)
+        , hash(combineConfigKeyHash(combineConfigKeyHash(0, name), subpath))
+    {
+    }
+    bool isValid() const { return name != 0; }
+    QString toString() const
+    {
+        return QString("/%1%2").arg(ConfigKeyAtoms::value(name), ConfigKeyAtoms::value(subpath));
+    }
+
+    quint32 name = 0;
+    quint32 subpath = 0;
+    ConfigKeyHash hash = 0;
+};
+
+// /appid/filename/subpath
+struct ResourceKey
+{
+    ResourceKey() = default;
+    ResourceKey(const quint32 appid, const GenericResourceKey &key)
+        : appid(appid)
+        , name(key.name)
+        , subpath(key.subpath)
+        , hash(combineConfigKeyHash(key.hash, appid))
+    {
+    }
+    GenericResourceKey genericKey() const { return GenericResourceKey(name, subpath); }
+    QString toString() const
+    {
+        return QString("/%1/%2%3").arg(ConfigKeyAtoms::value(appid),
+                                       ConfigKeyAtoms::value(name),
+                                       ConfigKeyAtoms::value(subpath));
+    }
+
+    quint32 appid = 0;
+    quint32 name = 0;
+    quint32 subpath = 0;
+    ConfigKeyHash hash = 0;
+};
+
+// /appid/filename/subpath/userid
+struct ConnKey
+{
+    ConnKey() = default;
+    ConnKey(const ResourceKey &resource, const uint uid)
+        : resource(resource)
+        , uid(uid)
+        , hash(combineConfigKeyHash(resource.hash, uid))
+    {
+    }
+    QString toString() const
+    {
+        return QString("%1/%2").arg(resource.toString()).arg(uid);
+    }
+
+    ResourceKey resource;
+    uint uid = 0;
+    ConfigKeyHash hash = 0;
+};
+
+// user: u-${ConnKey}, global: g-${ResourceKey}
+struct ConfigCacheKey
+{
+    ConfigCacheKey() = default;
+    ConfigCacheKey(const bool global, const ConnKey &key)
+        : global(global)
+        , key(key)
+    {
+    }
+    QString toString() const
+    {
+        return global ? QString("g-%1").arg(key.resource.toString()) : QString("u-%1").arg(key.toString());
+    }
+
+    bool global = false;
+    ConnKey key;
+};
+
+inline bool operator==(const GenericResourceKey &lhs, const GenericResourceKey &rhs)
+{
+    return lhs.name == rhs.name && lhs.subpath == rhs.subpath;
+}
+inline bool operator!=(const GenericResourceKey &lhs, const GenericResourceKey &rhs)
+{
+    return !(lhs == rhs);
+}
+inline bool operator<(const GenericResourceKey &lhs, const GenericResourceKey &rhs)
+{
+    return std::tie(lhs.name, lhs.subpath) < std::tie(rhs.name, rhs.subpath);
+}
+inline ConfigKeyHash qHash(const GenericResourceKey &key, ConfigKeyHash seed = 0)
+{
+    return key.hash ^ seed;
+}
+
+inline bool operator==(const ResourceKey &lhs, const ResourceKey &rhs)
+{
+    return lhs.hash == rhs.hash && lhs.appid == rhs.appid && lhs.name == rhs.name && lhs.subpath == rhs.subpath;
+}
+inline bool operator!=(const ResourceKey &lhs, const ResourceKey &rhs)
+{
+    return !(lhs == rhs);
+}
+inline bool operator<(const ResourceKey &lhs, const ResourceKey &rhs)
+{
+    return std::tie(lhs.appid, lhs.name, lhs.subpath) < std::tie(rhs.appid, rhs.name, rhs.subpath);
+}
+inline ConfigKeyHash qHash(const ResourceKey &key, ConfigKeyHash seed = 0)
+{
+    return key.hash ^ seed;
+}
+
+inline bool operator==(const ConnKey &lhs, const ConnKey &rhs)
+{
+    return lhs.uid == rhs.uid && lhs.resource == rhs.resource;
+}
+inline bool operator!=(const ConnKey &lhs, const ConnKey &rhs)
+{
+    return !(lhs == rhs);
+}
+inline bool operator<(const ConnKey &lhs, const ConnKey &rhs)
+{
+    if (lhs.resource != rhs.resource)
+        return lhs.resource < rhs.resource;
+    return lhs.uid < rhs.uid;
+}
+inline ConfigKeyHash qHash(const ConnKey &key, ConfigKeyHash seed = 0)
+{
+    return key.hash ^ seed;
+}
+
+inline bool operator==(const ConfigCacheKey &lhs, const ConfigCacheKey &rhs)
+{
+    return lhs.global == rhs.global && lhs.key == rhs.key;
+}
+inline bool operator!=(const ConfigCacheKey &lhs, const ConfigCacheKey &rhs)
+{
+    return !(lhs == rhs);
+}
+inline ConfigKeyHash qHash(const ConfigCacheKey &key, ConfigKeyHash seed = 0)
+{
+    return combineConfigKeyHash(key.key.hash, key.global) ^ seed;
+}
+
+inline QDebug operator<<(QDebug debug, const GenericResourceKey &key)
+{
+    return debug << key.toString();
+}
+inline QDebug operator<<(QDebug debug, const ResourceKey &key)
+{
+    return debug << key.toString();
+}
+inline QDebug operator<<(QDebug debug, const ConnKey &key)
+{
+    return debug << key.toString();
+}
+inline QDebug operator<<(QDebug debug, const ConfigCacheKey &key)
+{
+    return debug << key.toString();
+}
+
+Q_DECLARE_METATYPE(ConnKey)
+
+/*!
+ \brief 将连接key转换为合法的D-Bus对象路径，`.`、` `及`-`替换为`_`
+ 逐字符转换，不使用正则表达式。
+ */
 inline QString formatDBusObjectPath(QString path)
 {
-    return path.replace(QRegularExpression(QStringLiteral("[\\. -]")), QStringLiteral("_"));
+    for (QChar &ch : path) {
+        switch (ch.unicode()) {
+        case '.':
+        case ' ':
+        case '-':
+            ch = QLatin1Char('_');
+            break;
+        default:
+            break;
+        }
+    }
+    return path;
 }
 inline QString outerAppidToInner(const QString &appid)
 {
@@ -42,35 +351,40 @@ inline QString innerAppidToOuter(const QString &appid)
 }
 inline bool isGenericResourceConn(const ConnKey &connKey)
 {
-    return connKey.startsWith("/" + VirtualInterAppId);
+    static const quint32 virtualInterAppId = []() {
+        const auto id = ConfigKeyAtoms::intern(VirtualInterAppId);
+        ConfigKeyAtoms::ref(id);
+        return id;
+    }();
+    return connKey.resource.appid == virtualInterAppId;
 }
 inline ResourceKey getResourceKey(const QString &appid, const GenericResourceKey &key)
 {
-    return QString("/%1%2").arg(appid).arg(key);
+    return ResourceKey(ConfigKeyAtoms::intern(appid), key);
 }
 inline ResourceKey getResourceKey(const ConnKey &connKey)
 {
-    return connKey.left(connKey.lastIndexOf('/'));
+    return connKey.resource;
 }
 inline GenericResourceKey getGenericResourceKeyByResourceKey(const ResourceKey &resourceKey)
 {
-    return resourceKey.mid(resourceKey.indexOf('/', 1));
+    return resourceKey.genericKey();
 }
 inline GenericResourceKey getGenericResourceKey(const QString &name, const QString &subpath)
 {
-    return QString("/%1%2").arg(name, subpath);
+    return GenericResourceKey(ConfigKeyAtoms::intern(name), ConfigKeyAtoms::intern(subpath));
 }
 inline GenericResourceKey getGenericResourceKey(const ConnKey &connKey)
 {
-    return getGenericResourceKeyByResourceKey(getResourceKey(connKey));
+    return connKey.resource.genericKey();
 }
 inline uint getConnectionKey(const ConnKey &connKey)
 {
-    return connKey.mid(connKey.lastIndexOf('/') + 1).toUInt();
+    return connKey.uid;
 }
 inline ConnKey getConnectionKey(const ResourceKey &key, const uint uid)
 {
-    return QString("%1/%2").arg(key).arg(uid);
+    return ConnKey(key, uid);
 }
 
 struct ConfigureId {
@@ -82,61 +396,97 @@ struct ConfigureId {
     }
 };
 
-// remove slash if back is slash.
-static QString removeBackSlash(const QString &target)
+// 配置文件路径中合法的名称字符，与[a-zA-Z0-9\s_@^!#$%&.\-]一致
+inline bool isConfigureNameChar(const QChar ch)
+{
+    const ushort c = ch.unicode();
+    if ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9'))
+        return true;
+
+    switch (c) {
+    case ' ': case '\t': case '\n': case '\v': case '\f': case '\r':
+    case '_': case '@': case '^': case '!': case '#': case '$': case '%': case '&': case '.': case '-':
+        return true;
+    default:
+        return false;
+    }
+}
+
+/*!
+ \brief 逐字符将`from`之后的路径切分为非空的合法名称，最后一个名称需以`.json`结尾且去掉后缀
+ \return 存在非法字符或空名称时返回空
+ */
+inline QStringList splitConfigurePath(const QString &path, const int from)
 {
-    if (target.isEmpty() || target.back() != '/')
-        return target;
+    static const QLatin1String suffix(".json");
+    QStringList sections;
+    int begin = from;
+    for (int i = from; i <= path.size(); ++i) {
+        if (i < path.size() && path.at(i) != QLatin1Char('/')) {
+            if (!isConfigureNameChar(path.at(i)))
+                return QStringList();
+            continue;
+        }
+        if (i == begin)
+            return QStringList();
+
+        sections << path.mid(begin, i - begin);
+        begin = i + 1;
+    }
+    if (sections.isEmpty() || !sections.last().endsWith(suffix) || sections.last().size() == suffix.size())
+        return QStringList();
 
-    return target.left(target.size() - 1);
+    sections.last().chop(suffix.size());
+    return sections;
 }
 
 inline ConfigureId getMetaConfigureId(const QString &path)
 {
-    ConfigureId info;
     // /usr/share/dsg/configs/[$appid]/[$subpath]/$resource.json
-    // Use negative lookahead (?!overrides/) to exclude override paths which should be handled by getOverrideConfigureId
-    static QRegularExpression usrReg(
-        R"(/configs/(?!overrides/)(?<appid>(?>[a-zA-Z0-9\s_@^!#$%&.\-]+)\/)?(?<subpath>(?:(?>[a-zA-Z0-9\s_@^!#$%&.\-]+)\/)*)(?<resource>[a-zA-Z0-9\s_@^!#$%&.\-]+)\.json$)"
-    );
-
-    QRegularExpressionMatch match;
-    match = usrReg.match(path);
-    if (!match.hasMatch()) {
+    // override paths are handled by getOverrideConfigureId.
+    static const QLatin1String configs("/configs/");
+    static const QLatin1String overrides("overrides/");
+    for (int index = path.indexOf(configs); index >= 0; index = path.indexOf(configs, index + 1)) {
+        const int from = index + configs.size();
+        if (QStringView(path).mid(from).startsWith(overrides))
+            continue;
+
+        const auto &sections = splitConfigurePath(path, from);
+        if (sections.isEmpty())
+            continue;
+
+        ConfigureId info;
+        info.resource = sections.last();
+        if (sections.size() > 1) {
+            info.appid = sections.first();
+            info.subpath = sections.mid(1, sections.size() - 2).join(QLatin1Char('/'));
+        }
         return info;
     }
-    info.appid = removeBackSlash(match.captured("appid"));
-    info.subpath = removeBackSlash(match.captured("subpath"));
-    info.resource = match.captured("resource");
-
-    return info;
+    return ConfigureId();
 }
 
 inline ConfigureId getOverrideConfigureId(const QString &path)
 {
-    ConfigureId info;
     // /usr/share/dsg/configs/overrides/[$appid]/$resource/[$subpath]/$override_id.json
-    static QRegularExpression usrReg(
-        R"(/configs/overrides/(?<appid>(?>[a-zA-Z0-9\s_@^!#$%&.\-]+)\/)?(?<resource>(?>[a-zA-Z0-9\s_@^!#$%&.\-]+))/(?<subpath>(?:(?>[a-zA-Z0-9\s_@^!#$%&.\-]+)\/)*)(?<configurationid>[a-zA-Z0-9\s_@^!#$%&.\-]+)\.json$)"
-    );
-
     // /etc/dsg/configs/overrides/[$appid]/$resource/[$subpath]/$override_id.json
-    static QRegularExpression etcReg(
-        R"(^/etc/dsg/configs/overrides/(?<appid>(?>[a-zA-Z0-9\s_@^!#$%&.\-]+)\/)?(?<resource>(?>[a-zA-Z0-9\s_@^!#$%&.\-]+))/(?<subpath>(?:(?>[a-zA-Z0-9\s_@^!#$%&.\-]+)\/)*)(?<configurationid>[a-zA-Z0-9\s_@^!#$%&.\-]+)\.json$)"
-    );
-
-    QRegularExpressionMatch match;
-    match = usrReg.match(path);
-    if (!match.hasMatch()) {
-        match = etcReg.match(path);
-        if (!match.hasMatch())
-            return info;
-    }
-    info.appid = removeBackSlash(match.captured("appid"));
-    info.subpath = removeBackSlash(match.captured("subpath"));
-    info.resource = match.captured("resource");
-
-    return info;
+    static const QLatin1String overrides("/configs/overrides/");
+    for (int index = path.indexOf(overrides); index >= 0; index = path.indexOf(overrides, index + 1)) {
+        const auto &sections = splitConfigurePath(path, index + overrides.size());
+        if (sections.size() < 2)
+            continue;
+
+        ConfigureId info;
+        if (sections.size() == 2) {
+            info.resource = sections.first();
+        } else {
+            info.appid = sections.at(0);
+            info.resource = sections.at(1);
+            info.subpath = sections.mid(2, sections.size() - 3).join(QLatin1Char('/'));
+        }
+        return info;
+    }
+    return ConfigureId();
 }
 
 template<class T>
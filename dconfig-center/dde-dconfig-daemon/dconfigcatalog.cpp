@@ -0,0 +1,150 @@
+// SPDX-FileCopyrightText: 2026 Uniontech Software Technology Co.,Ltd.
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#include "dconfigcatalog.h"
+
+#include <QDir>
+
+static constexpr char const *Suffix = ".json";
+
+/*!
+ \brief 根据扫描到的所有文件重新建立目录
+ \a metaDirs 描述文件所在的目录
+ \a filePaths 文件列表，不在描述文件目录下或位于overrides目录的文件被忽略
+ */
+void DSGConfigCatalog::rebuild(const QStringList &metaDirs, const QStringList &filePaths)
+{
+    clear();
+    for (const auto &filePath : filePaths)
+        insert(QDir::cleanPath(filePath), parse(metaDirs, filePath));
+}
+
+/*!
+ \brief 更新单个文件对应的条目
+ \a exists 文件是否存在，不存在时移除
+ */
+void DSGConfigCatalog::update(const QStringList &metaDirs, const QString &filePath, bool exists)
+{
+    const auto &path = QDir::cleanPath(filePath);
+    remove(path);
+    if (exists)
+        insert(path, parse(metaDirs, path));
+}
+
+void DSGConfigCatalog::clear()
+{
+    m_files.clear();
+    m_entries.clear();
+}
+
+/*!
+ \brief 返回所有存在配置的应用，不包含公共配置的空appid
+ */
+QStringList DSGConfigCatalog::apps() const
+{
+    QStringList result;
+    for (auto iter = m_entries.cbegin(); iter != m_entries.cend(); ++iter) {
+        if (!iter.key().isEmpty())
+            result << iter.key();
+    }
+    return result;
+}
+
+/*!
+ \brief 返回应用目录下的配置，appid为空时返回公共配置
+ */
+QStringList DSGConfigCatalog::resources(const QString &appid) const
+{
+    QStringList result;
+    const auto &resources = m_entries.value(appid);
+    for (auto iter = resources.cbegin(); iter != resources.cend(); ++iter) {
+        if (iter.value().contains(QString()))
+            result << iter.key();
+    }
+    return result;
+}
+
+/*!
+ \brief 返回配置所在的子目录，如`/a/b`
+ */
+QStringList DSGConfigCatalog::subpaths(const QString &appid, const QString &resource) const
+{
+    QStringList result;
+    const auto &subpaths = m_entries.value(appid).value(resource);
+    for (auto iter = subpaths.cbegin(); iter != subpaths.cend(); ++iter) {
+        if (!iter.key().isEmpty())
+            result << iter.key();
+    }
+    return result;
+}
+
+/*
+  \internal
+
+    \breaf 解析描述文件对应的条目，与helper.hpp中遍历目录的结果保持一致，
+    `$metaDir/$appid/[$subpath/]$resource.json`属于应用，
+    同时`$metaDir/$subpath/$resource.json`作为公共配置的子目录。
+*/
+QList<DSGConfigCatalog::Entry> DSGConfigCatalog::parse(const QStringList &metaDirs, const QString &filePath)
+{
+    QList<Entry> entries;
+    const auto &path = QDir::cleanPath(filePath);
+    if (!path.endsWith(Suffix))
+        return entries;
+
+    for (const auto &dir : metaDirs) {
+        const auto &metaDir = QDir::cleanPath(dir) + '/';
+        if (!path.startsWith(metaDir))
+            continue;
+
+        const auto &sections = path.mid(metaDir.size()).split('/', Qt::SkipEmptyParts);
+        if (sections.isEmpty() || sections.first() == QLatin1String("overrides"))
+            break;
+
+        const auto &resource = sections.last().chopped(static_cast<int>(strlen(Suffix)));
+        if (sections.size() == 1) {
+            entries << Entry{QString(), resource, QString()};
+            break;
+        }
+
+        const auto &subpath = sections.mid(1, sections.size() - 2).join('/');
+        entries << Entry{sections.first(), resource, subpath.isEmpty() ? QString() : '/' + subpath};
+        entries << Entry{QString(), resource, '/' + sections.mid(0, sections.size() - 1).join('/')};
+        break;
+    }
+    return entries;
+}
+
+void DSGConfigCatalog::insert(const QString &filePath, const QList<Entry> &entries)
+{
+    if (entries.isEmpty() || m_files.contains(filePath))
+        return;
+
+    m_files.insert(filePath, entries);
+    for (const auto &entry : entries)
+        ++m_entries[entry.appid][entry.resource][entry.subpath];
+}
+
+void DSGConfigCatalog::remove(const QString &filePath)
+{
+    const auto &entries = m_files.take(filePath);
+    for (const auto &entry : entries) {
+        auto app = m_entries.find(entry.appid);
+        if (app == m_entries.end())
+            continue;
+        auto resource = app->find(entry.resource);
+        if (resource == app->end())
+            continue;
+        auto subpath = resource->find(entry.subpath);
+        if (subpath == resource->end())
+            continue;
+
+        if (--subpath.value() <= 0)
+            resource->erase(subpath);
+        if (resource->isEmpty())
+            app->erase(resource);
+        if (app->isEmpty())
+            m_entries.erase(app);
+    }
+}
@@ -0,0 +1,42 @@
+// SPDX-FileCopyrightText: 2026 Uniontech Software Technology Co.,Ltd.
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#pragma once
+
+#include <QHash>
+#include <QMap>
+#include <QStringList>
+
+/**
+ * @brief The DSGConfigCatalog class
+ * 描述文件的目录，记录已安装的应用、配置及子目录，
+ * 由服务扫描配置目录时建立，供工具查询，避免工具重复遍历配置目录。
+ */
+class DSGConfigCatalog
+{
+public:
+    void rebuild(const QStringList &metaDirs, const QStringList &filePaths);
+    void update(const QStringList &metaDirs, const QString &filePath, bool exists);
+    void clear();
+
+    QStringList apps() const;
+    QStringList resources(const QString &appid) const;
+    QStringList subpaths(const QString &appid, const QString &resource) const;
+
+private:
+    struct Entry {
+        QString appid;
+        QString resource;
+        QString subpath;
+    };
+    static QList<Entry> parse(const QStringList &metaDirs, const QString &filePath);
+    void insert(const QString &filePath, const QList<Entry> &entries);
+    void remove(const QString &filePath);
+
+private:
+    // 描述文件路径及其对应的条目，同一个文件可能对应多个条目
+    QHash<QString, QList<Entry>> m_files;
+    // appid -> resource -> subpath -> 文件数量，subpath为空表示应用目录下的配置
+    QMap<QString, QMap<QString, QMap<QString, int>>> m_entries;
+};
@@ -18,12 +18,16 @@ DCORE_USE_NAMESPACE
 
 DSGConfigConn::DSGConfigConn(const ConnKey &key, QObject *parent)
     : QObject (parent),
-      m_key(key)
+      m_key(key),
+      m_resourceKey(getResourceKey(key)),
+      m_path(formatDBusObjectPath(key.toString()))
 {
 }
 
 DSGConfigConn::~DSGConfigConn()
 {
+    qCDebug(cfLog, "Value cache of the connection:%s, hits:%llu, misses:%llu.",
+            qPrintable(m_key.toString()), m_valueCacheHits, m_valueCacheMisses);
 }
 
 ConnKey DSGConfigConn::key() const
@@ -31,14 +35,19 @@ ConnKey DSGConfigConn::key() const
     return m_key;
 }
 
+ResourceKey DSGConfigConn::resourceKey() const
+{
+    return m_resourceKey;
+}
+
 QString DSGConfigConn::path() const
 {
-    return formatDBusObjectPath(m_key);
+    return m_path;
 }
 
 bool DSGConfigConn::containsWithoutProp(const QString &key) const
 {
-    return keyList().contains(key);
+    return keyInfo(key) != nullptr;
 }
 
 void DSGConfigConn::setResource(DSGConfigResource *resource)
@@ -46,6 +55,67 @@ void DSGConfigConn::setResource(DSGConfigResource *resource)
     m_resource = resource;
 }
 
+void DSGConfigConn::setCallContext(DSGConfigCallContext *context)
+{
+    m_callContext = context;
+}
+
+bool DSGConfigConn::calledFromDBus() const
+{
+    return m_callContext != nullptr;
+}
+
+const QDBusMessage &DSGConfigConn::message() const
+{
+    return m_callContext->message;
+}
+
+QDBusConnection DSGConfigConn::connection() const
+{
+    return m_callContext->connection;
+}
+
+/*!
+ \brief 设置当前调用的错误回复，由分发者代替正常回复发送
+ */
+void DSGConfigConn::sendErrorReply(QDBusError::ErrorType type, const QString &msg) const
+{
+    m_callContext->errorReply = m_callContext->message.createErrorReply(type, msg);
+}
+
+/*!
+ \brief 使指定配置项的取值缓存失效
+ \a key 配置项名称
+ */
+void DSGConfigConn::invalidateValue(const QString &key)
+{
+    m_values.remove(key);
+}
+
+/*!
+ \brief 使所有配置项的取值缓存失效
+ */
+void DSGConfigConn::invalidateValues()
+{
+    m_values.clear();
+}
+
+quint64 DSGConfigConn::valueCacheHits() const
+{
+    return m_valueCacheHits;
+}
+
+quint64 DSGConfigConn::valueCacheMisses() const
+{
+    return m_valueCacheMisses;
+}
+
+double DSGConfigConn::valueCacheHitRatio() const
+{
+    const auto total = m_valueCacheHits + m_valueCacheMisses;
+    return total > 0 ? static_cast<double>(m_valueCacheHits) / total : 0.0;
+}
+
 /*!
  \brief 返回配置内容的所有配置项
  \return
@@ -100,7 +170,7 @@ QString DSGConfigConn::name(const QString &key, const QString &locale)
 void DSGConfigConn::release()
 {
     const QString &service = calledFromDBus() ? message().service() : "test.service";
-    qCDebug(cfLog, "Received release request, service:%s, path:%s.", qPrintable(service), qPrintable(m_key));
+    qCDebug(cfLog, "Received release request, service:%s, path:%s.", qPrintable(service), qPrintable(m_key.toString()));
 
     emit releaseChanged(service);
 }
@@ -118,16 +188,8 @@ void DSGConfigConn::setValue(const QString &key, const QDBusVariant &value)
     if (!hasPermissionByUid(key))
         return;
 
-    const auto &v = decodeQDBusArgument(value.variant());
-    qCDebug(cfLog) << "Set value, key:" << key << ", now value:" << v << ", old value:" << file()->value(key, cache());
-    if(!file()->setValue(key, v, getAppid(), cache()))
-        return;
-
-    if (meta()->flags(key).testFlag(DConfigFile::Global)) {
-        emit globalValueChanged(key);
-    } else {
-        emit valueChanged(key);
-    }
+    if (writeValue(key, decodeQDBusArgument(value.variant())))
+        notifyValueChanged(key);
 }
 
 void DSGConfigConn::reset(const QString &key)
@@ -135,15 +197,8 @@ void DSGConfigConn::reset(const QString &key)
     if (!contains(key))
         return;
 
-    qCDebug(cfLog) << "Reset value, key:" << key << ", old value:" << file()->value(key, cache());
-    if(!file()->setValue(key, QVariant(), getAppid(), cache()))
-        return;
-
-    if (meta()->flags(key).testFlag(DConfigFile::Global)) {
-        emit globalValueChanged(key);
-    } else {
-        emit valueChanged(key);
-    }
+    if (writeValue(key, QVariant()))
+        notifyValueChanged(key);
 }
 
 /*!
@@ -159,33 +214,7 @@ QDBusVariant DSGConfigConn::value(const QString &key)
     if (!hasPermissionByUid(key))
         return QDBusVariant();
 
-    // Try to get value from cache.
-    auto value = file()->cacheValue(cache(), key);
-    if (value.isNull()) {
-        const bool canFallback = m_resource->fallbackToGenericConfig();
-        // Fallback to generic configuration.
-        if (canFallback) {
-            const auto uid = getConnectionKey(m_key);
-            const auto &tmp = m_resource->noAppidFile()->cacheValue(m_resource->noAppidCache(uid), key);
-            if (!tmp.isNull()) {
-                value = tmp;
-                qCDebug(cfLog) << "Get [" << key << "]'s cache value from generic configuration.";
-            }
-        }
-        // Fallback to meta or global configuration.
-        if (value.isNull())
-            value = file()->value(key);
-
-        // Fallback to generic meta configuration.
-        if (value.isNull() && canFallback) {
-            const auto &tmp = m_resource->noAppidFile()->value(key);
-            if (!tmp.isNull()) {
-                value = tmp;
-                qCDebug(cfLog) << "Get [" << key << "]'s meta value from generic configuration.";
-            }
-        }
-    }
-
+    const auto &value = resolveValue(key);
     if (value.isNull()) {
         QString errorMsg = QString("[%1] Requires the value in [%2].").arg(key).arg(getAppid());
         qWarning() << qPrintable(errorMsg);
@@ -195,10 +224,128 @@ QDBusVariant DSGConfigConn::value(const QString &key)
         return QDBusVariant();
     }
 
-    qCDebug(cfLog) << "Get value key:" << key << ", value:" << value;
     return QDBusVariant{value};
 }
 
+/*!
+ \brief 批量返回配置项的值
+ 不存在、无权限或无值的配置项不包含在结果中，不产生错误。
+ \a keys 配置项名称列表
+ \return 配置项名称及其值
+ */
+QVariantMap DSGConfigConn::values(const QStringList &keys)
+{
+    QVariantMap result;
+    for (const auto &key : keys) {
+        if (!containsWithoutProp(key) || !checkPermissionByUid(key))
+            continue;
+
+        const auto &value = resolveValue(key);
+        if (!value.isNull())
+            result.insert(key, value);
+    }
+    return result;
+}
+
+/*!
+ \brief 返回所有配置项的值
+ \return 配置项名称及其值
+ */
+QVariantMap DSGConfigConn::allValues()
+{
+    return values(keyList());
+}
+
+/*!
+ \brief 批量设置配置项的值
+ 所有配置项设置完成后只产生一次保存请求，不存在或无权限的配置项被忽略并在调用结束时返回错误。
+ \a values 配置项名称及需要设置的值
+ */
+void DSGConfigConn::setValues(const QVariantMap &values)
+{
+    QStringList rejectedKeys;
+    QStringList changedKeys;
+    for (auto iter = values.cbegin(); iter != values.cend(); ++iter) {
+        const auto &key = iter.key();
+        if (!containsWithoutProp(key) || !checkPermissionByUid(key)) {
+            rejectedKeys << key;
+            continue;
+        }
+        if (writeValue(key, decodeQDBusArgument(iter.value())))
+            changedKeys << key;
+    }
+
+    for (const auto &key : std::as_const(changedKeys))
+        notifyValueChanged(key);
+
+    if (!rejectedKeys.isEmpty()) {
+        QString errorMsg = QString("[%1] Can't set configure items [%2] in [%3].").arg(getAppid()).arg(rejectedKeys.join(",")).arg(m_key.toString());
+        if (calledFromDBus())
+            sendErrorReply(QDBusError::Failed, errorMsg);
+        qWarning() << qPrintable(errorMsg);
+    }
+}
+
+/*!
+ \brief 重置所有配置项的值
+ 只重置已被修改过的配置项，所有配置项重置完成后只产生一次保存请求。
+ */
+void DSGConfigConn::resetAll()
+{
+    QStringList changedKeys;
+    for (const auto &key : keyList()) {
+        if (!file()->cacheValue(cache(), key).isValid())
+            continue;
+
+        if (writeValue(key, QVariant()))
+            changedKeys << key;
+    }
+
+    for (const auto &key : std::as_const(changedKeys))
+        notifyValueChanged(key);
+}
+
+/*!
+ \brief 返回所有配置项的描述信息
+ 包含显示名称、描述、值、是否为默认值、可见性、权限及标志，指定语言的名称或描述为空时使用默认语言。
+ 无权限读取的配置项不包含值。
+ \a locale 语言版本,为空时返回默认语言的信息
+ \return 配置项名称及其描述信息
+ */
+ConfigKeyDescriptions DSGConfigConn::describe(const QString &locale)
+{
+    const auto language = locale.isEmpty() ? QLocale(QLocale::AnyLanguage) : QLocale(locale);
+    const auto defaultLanguage = QLocale(QLocale::AnyLanguage);
+    auto meta = this->meta();
+    ConfigKeyDescriptions result;
+    for (const auto &key : meta->keyList()) {
+        QVariantMap info;
+        auto name = meta->displayName(key, language);
+        if (name.isEmpty() && !locale.isEmpty())
+            name = meta->displayName(key, defaultLanguage);
+        info.insert(QStringLiteral("name"), name);
+
+        auto description = meta->description(key, language);
+        if (description.isEmpty() && !locale.isEmpty())
+            description = meta->description(key, defaultLanguage);
+        info.insert(QStringLiteral("description"), description);
+
+        if (checkPermissionByUid(key)) {
+            const auto &value = resolveValue(key);
+            if (!value.isNull())
+                info.insert(QStringLiteral("value"), value);
+        }
+        info.insert(QStringLiteral("isDefaultValue"), !file()->cacheValue(cache(), key).isValid());
+        info.insert(QStringLiteral("visibility"), meta->visibility(key) == DTK_CORE_NAMESPACE::DConfigFile::Private ? QString("private") : QString("public"));
+        info.insert(QStringLiteral("permissions"), meta->permissions(key) == DTK_CORE_NAMESPACE::DConfigFile::ReadWrite ? QString("readwrite") : QString("readonly"));
+        const auto keyInfo = this->keyInfo(key);
+        info.insert(QStringLiteral("flags"), keyInfo ? static_cast<int>(keyInfo->flags) : 0);
+
+        result.insert(key, info);
+    }
+    return result;
+}
+
 bool DSGConfigConn::isDefaultValue(const QString &key)
 {
     if (!contains(key))
@@ -235,15 +382,19 @@ QString DSGConfigConn::permissions(const QString &key)
 
 int DSGConfigConn::flags(const QString &key)
 {
-    return static_cast<int>(meta()->flags(key));
+    const auto info = keyInfo(key);
+    return info ? static_cast<int>(info->flags) : 0;
 }
 
 QString DSGConfigConn::getAppid() const
 {
     if (m_appName.isEmpty()) {
         if (calledFromDBus()) {
-            const QString &service = message().service();
-            const_cast<DSGConfigConn *>(this)->m_appName = getProcessNameByPid(connection().interface()->servicePid(service));
+            const auto &credential = callerCredential();
+            if (!credential)
+                return message().service();
+
+            const_cast<DSGConfigConn *>(this)->m_appName = credential->processName;
         } else {
             const_cast<DSGConfigConn *>(this)->m_appName = QString("testappid");
         }
@@ -256,7 +407,7 @@ bool DSGConfigConn::contains(const QString &key)
     if (containsWithoutProp(key))
         return true;
 
-    QString errorMsg = QString("[%1] Requires Non-existent configure item [%2] in [%3].").arg(getAppid()).arg(key).arg(m_key);
+    QString errorMsg = QString("[%1] Requires Non-existent configure item [%2] in [%3].").arg(getAppid()).arg(key).arg(m_key.toString());
     if (calledFromDBus())
         sendErrorReply(QDBusError::Failed, errorMsg);
     qWarning() << qPrintable(errorMsg);
@@ -271,8 +422,7 @@ DConfigMeta *DSGConfigConn::meta() const
 
 DConfigFile *DSGConfigConn::file() const
 {
-    const auto &resourceKey = getResourceKey(m_key);
-    return m_resource->getFile(resourceKey);
+    return m_resource->getFile(m_resourceKey);
 }
 
 DConfigCache *DSGConfigConn::cache() const
@@ -280,24 +430,114 @@ DConfigCache *DSGConfigConn::cache() const
     return m_resource->getCache(m_key);
 }
 
+const ConfigKeyInfo *DSGConfigConn::keyInfo(const QString &key) const
+{
+    return m_resource->keyInfo(m_resourceKey, key);
+}
+
 bool DSGConfigConn::hasPermissionByUid(const QString &key) const
 {
-    auto flags = meta()->flags(key);
-    if (flags.testFlag(DConfigFile::UserPublic))
+    if (checkPermissionByUid(key))
+        return true;
+
+    QString errorMsg = QString("[%1] No Permission configure item [%2] in [%3].").arg(getAppid()).arg(key).arg(m_key.toString());
+    sendErrorReply(QDBusError::AccessDenied, errorMsg);
+    qWarning() << qPrintable(errorMsg);
+    return false;
+}
+
+bool DSGConfigConn::checkPermissionByUid(const QString &key) const
+{
+    const auto info = keyInfo(key);
+    if (info && info->flags.testFlag(DConfigFile::UserPublic))
         return true;
 
     if (!calledFromDBus())
         return true;
 
-    const QString &service = message().service();
-    const uint callerUid = connection().interface()->serviceUid(service);
-    const auto connectionUid = getConnectionKey(m_key);
-    bool hasPermission = callerUid == connectionUid;
+    const auto &credential = callerCredential();
+    return credential && credential->uid == getConnectionKey(m_key);
+}
 
-    if (!hasPermission) {
-        QString errorMsg = QString("[%1] No Permission configure item [%2] in [%3].").arg(getAppid()).arg(key).arg(m_key);
-        sendErrorReply(QDBusError::AccessDenied, errorMsg);
-        qWarning() << qPrintable(errorMsg);
+/*
+  \internal
+
+    \breaf 获取配置项的最终取值，依次回退到公共配置及描述文件，结果被缓存直到失效
+*/
+QVariant DSGConfigConn::resolveValue(const QString &key)
+{
+    auto cachedValue = m_values.constFind(key);
+    if (cachedValue != m_values.constEnd()) {
+        ++m_valueCacheHits;
+        qCDebug(cfLog) << "Get value key:" << key << ", value:" << cachedValue.value();
+        return cachedValue.value();
     }
-    return hasPermission;
+    ++m_valueCacheMisses;
+
+    // Try to get value from cache.
+    auto value = file()->cacheValue(cache(), key);
+    if (value.isNull()) {
+        const bool canFallback = m_resource->fallbackToGenericConfig();
+        // Fallback to generic configuration.
+        if (canFallback) {
+            const auto uid = getConnectionKey(m_key);
+            const auto &tmp = m_resource->noAppidFile()->cacheValue(m_resource->noAppidCache(uid), key);
+            if (!tmp.isNull()) {
+                value = tmp;
+                qCDebug(cfLog) << "Get [" << key << "]'s cache value from generic configuration.";
+            }
+        }
+        // Fallback to meta or global configuration.
+        if (value.isNull())
+            value = file()->value(key);
+
+        // Fallback to generic meta configuration.
+        if (value.isNull() && canFallback) {
+            const auto &tmp = m_resource->noAppidFile()->value(key);
+            if (!tmp.isNull()) {
+                value = tmp;
+                qCDebug(cfLog) << "Get [" << key << "]'s meta value from generic configuration.";
+            }
+        }
+    }
+
+    if (value.isNull())
+        return value;
+
+    m_values.insert(key, value);
+    qCDebug(cfLog) << "Get value key:" << key << ", value:" << value;
+    return value;
+}
+
+/*
+  \internal
+
+    \breaf 写入配置项的值，value为空时重置，返回值是否被写入
+*/
+bool DSGConfigConn::writeValue(const QString &key, const QVariant &value)
+{
+    qCDebug(cfLog) << "Set value, key:" << key << ", now value:" << value << ", old value:" << file()->value(key, cache());
+    if (!file()->setValue(key, value, getAppid(), cache()))
+        return false;
+
+    invalidateValue(key);
+    return true;
+}
+
+void DSGConfigConn::notifyValueChanged(const QString &key)
+{
+    if (keyInfo(key)->flags.testFlag(DConfigFile::Global)) {
+        emit globalValueChanged(key);
+    } else {
+        emit valueChanged(key);
+    }
+}
+
+std::optional<ServiceCredential> DSGConfigConn::callerCredential() const
+{
+    const QString &service = message().service();
+    if (auto credentials = m_resource ? m_resource->credentialCache() : nullptr)
+        return credentials->credential(connection(), service);
+
+    return ServiceCredentialCache::query(connection(), service);
 }
@@ -5,10 +5,16 @@
 #pragma once
 
 #include "dconfig_global.h"
+#include "dconfigcredentials.h"
+#include "dbustypes.h"
 #include <dtkcore_global.h>
 #include <QObject>
+#include <QHash>
+#include <QVariant>
 #include <QDBusObjectPath>
-#include <QDBusContext>
+#include <QDBusMessage>
+#include <QDBusConnection>
+#include <QDBusError>
 
 DCORE_BEGIN_NAMESPACE
 class DConfigFile;
@@ -16,13 +22,22 @@ class DConfigCache;
 class DConfigMeta;
 DCORE_END_NAMESPACE
 
+// 正在分发给连接的D-Bus调用，由DSGConfigConnDispatcher在调用期间设置
+struct DSGConfigCallContext
+{
+    const QDBusMessage &message;
+    QDBusConnection connection;
+    QDBusMessage errorReply;
+};
+
 /**
  * @brief The DSGConfigConn class
  * 管理单个链接
- * 配置文件的解析及方法调用
+ * 配置文件的解析及方法调用，D-Bus调用由DSGConfigConnDispatcher按对象路径分发
  */
 class DSGConfigResource;
-class DSGConfigConn : public QObject, protected QDBusContext
+struct ConfigKeyInfo;
+class DSGConfigConn : public QObject
 {
     Q_OBJECT
 public:
@@ -31,10 +46,18 @@ public:
     virtual ~DSGConfigConn() override;
 
     ConnKey key() const;
+    ResourceKey resourceKey() const;
     QString path() const;
     bool containsWithoutProp(const QString &key) const;
 
     void setResource(DSGConfigResource *resource);
+    void setCallContext(DSGConfigCallContext *context);
+
+    void invalidateValue(const QString &key);
+    void invalidateValues();
+    quint64 valueCacheHits() const;
+    quint64 valueCacheMisses() const;
+    double valueCacheHitRatio() const;
 Q_SIGNALS:
     void releaseChanged(const ConnServiceName &service);
 
@@ -52,6 +75,11 @@ public Q_SLOTS: // METHODS
     void setValue(const QString &key, const QDBusVariant &value);
     void reset(const QString &key);
     QDBusVariant value(const QString &key);
+    QVariantMap values(const QStringList &keys);
+    QVariantMap allValues();
+    void setValues(const QVariantMap &values);
+    void resetAll();
+    ConfigKeyDescriptions describe(const QString &locale);
     bool isDefaultValue(const QString &key);
     QString visibility(const QString &key) ;
     QString permissions(const QString &key) ;
@@ -61,16 +89,36 @@ Q_SIGNALS: // SIGNALS
     void globalValueChanged(const QString &key);
 
 private:
+    bool calledFromDBus() const;
+    const QDBusMessage &message() const;
+    QDBusConnection connection() const;
+    void sendErrorReply(QDBusError::ErrorType type, const QString &msg) const;
+
     QString getAppid() const;
     bool contains(const QString &key);
     DTK_CORE_NAMESPACE::DConfigMeta *meta() const;
     DTK_CORE_NAMESPACE::DConfigFile *file() const;
     DTK_CORE_NAMESPACE::DConfigCache *cache() const;
+    const ConfigKeyInfo *keyInfo(const QString &key) const;
     bool hasPermissionByUid(const QString &key) const;
+    bool checkPermissionByUid(const QString &key) const;
+    QVariant resolveValue(const QString &key);
+    bool writeValue(const QString &key, const QVariant &value);
+    void notifyValueChanged(const QString &key);
+    std::optional<ServiceCredential> callerCredential() const;
 
 private:
     ConnKey m_key;
+    ResourceKey m_resourceKey;
+    // D-Bus对象路径，创建连接时生成
+    QString m_path;
     DSGConfigResource *m_resource = nullptr;
+    DSGConfigCallContext *m_callContext = nullptr;
     QString m_appName;
+
+    // 配置项最终取值的缓存，值可能改变时由资源失效
+    QHash<QString, QVariant> m_values;
+    quint64 m_valueCacheHits = 0;
+    quint64 m_valueCacheMisses = 0;
 };
 
@@ -0,0 +1,307 @@
+// SPDX-FileCopyrightText: 2026 Uniontech Software Technology Co.,Ltd.
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#include "dconfigconndispatcher.h"
+#include "dconfigconn.h"
+#include <QDBusMessage>
+#include <QDBusVariant>
+#include <QDBusArgument>
+#include <QDBusMetaType>
+#include <QFile>
+#include <QSet>
+#include <QDebug>
+#include <functional>
+
+static const QString ManagerInterface = QStringLiteral("org.desktopspec.ConfigManager.Manager");
+static const QString PropertiesInterface = QStringLiteral("org.freedesktop.DBus.Properties");
+
+struct ManagerMethod
+{
+    QString signature;
+    std::function<QVariantList(DSGConfigConn *conn, const QVariantList &arguments)> invoke;
+};
+
+// `org.desktopspec.ConfigManager.Manager`接口的方法，与services/org.desktopspec.ConfigManager.Manager.xml保持一致
+static const QHash<QString, ManagerMethod> &managerMethods()
+{
+    static const QHash<QString, ManagerMethod> methods {
+        {QStringLiteral("value"), {QStringLiteral("s"), [](DSGConfigConn *conn, const QVariantList &arguments) -> QVariantList {
+            return {QVariant::fromValue(conn->value(arguments.at(0).toString()))};
+        }}},
+        {QStringLiteral("values"), {QStringLiteral("as"), [](DSGConfigConn *conn, const QVariantList &arguments) -> QVariantList {
+            return {QVariant::fromValue(conn->values(qdbus_cast<QStringList>(arguments.at(0))))};
+        }}},
+        {QStringLiteral("allValues"), {QString(), [](DSGConfigConn *conn, const QVariantList &) -> QVariantList {
+            return {QVariant::fromValue(conn->allValues())};
+        }}},
+        {QStringLiteral("setValues"), {QStringLiteral("a{sv}"), [](DSGConfigConn *conn, const QVariantList &arguments) -> QVariantList {
+            conn->setValues(qdbus_cast<QVariantMap>(arguments.at(0)));
+            return {};
+        }}},
+        {QStringLiteral("resetAll"), {QString(), [](DSGConfigConn *conn, const QVariantList &) -> QVariantList {
+            conn->resetAll();
+            return {};
+        }}},
+        {QStringLiteral("describe"), {QStringLiteral("s"), [](DSGConfigConn *conn, const QVariantList &arguments) -> QVariantList {
+            return {QVariant::fromValue(conn->describe(arguments.at(0).toString()))};
+        }}},
+        {QStringLiteral("isDefaultValue"), {QStringLiteral("s"), [](DSGConfigConn *conn, const QVariantList &arguments) -> QVariantList {
+            return {conn->isDefaultValue(arguments.at(0).toString())};
+        }}},
+        {QStringLiteral("setValue"), {QStringLiteral("sv"), [](DSGConfigConn *conn, const QVariantList &arguments) -> QVariantList {
+            conn->setValue(arguments.at(0).toString(), qvariant_cast<QDBusVariant>(arguments.at(1)));
+            return {};
+        }}},
+        {QStringLiteral("reset"), {QStringLiteral("s"), [](DSGConfigConn *conn, const QVariantList &arguments) -> QVariantList {
+            conn->reset(arguments.at(0).toString());
+            return {};
+        }}},
+        {QStringLiteral("name"), {QStringLiteral("ss"), [](DSGConfigConn *conn, const QVariantList &arguments) -> QVariantList {
+            return {conn->name(arguments.at(0).toString(), arguments.at(1).toString())};
+        }}},
+        {QStringLiteral("description"), {QStringLiteral("ss"), [](DSGConfigConn *conn, const QVariantList &arguments) -> QVariantList {
+            return {conn->description(arguments.at(0).toString(), arguments.at(1).toString())};
+        }}},
+        {QStringLiteral("visibility"), {QStringLiteral("s"), [](DSGConfigConn *conn, const QVariantList &arguments) -> QVariantList {
+            return {conn->visibility(arguments.at(0).toString())};
+        }}},
+        {QStringLiteral("permissions"), {QStringLiteral("s"), [](DSGConfigConn *conn, const QVariantList &arguments) -> QVariantList {
+            return {conn->permissions(arguments.at(0).toString())};
+        }}},
+        {QStringLiteral("flags"), {QStringLiteral("s"), [](DSGConfigConn *conn, const QVariantList &arguments) -> QVariantList {
+            return {conn->flags(arguments.at(0).toString())};
+        }}},
+        {QStringLiteral("release"), {QString(), [](DSGConfigConn *conn, const QVariantList &) -> QVariantList {
+            conn->release();
+            return {};
+        }}},
+    };
+    return methods;
+}
+
+static QString managerInterfaceXml()
+{
+    static const QString xml = []() {
+        QFile file(QStringLiteral(":/dbus/org.desktopspec.ConfigManager.Manager.xml"));
+        if (!file.open(QIODevice::ReadOnly)) {
+            qCWarning(cfLog) << "Can't open the introspection data:" << file.fileName();
+            return QString();
+        }
+        return QString::fromUtf8(file.readAll());
+    }();
+    return xml;
+}
+
+// 路径的第一级，如`/org_foo_appid/example/1000`的前缀为`/org_foo_appid`
+static QString pathPrefix(const QString &path)
+{
+    return QString("/%1").arg(path.section('/', 1, 1));
+}
+
+DSGConfigConnDispatcher::DSGConfigConnDispatcher(const QDBusConnection &connection, QObject *parent)
+    : QDBusVirtualObject(parent)
+    , m_connection(connection)
+{
+}
+
+DSGConfigConnDispatcher::~DSGConfigConnDispatcher()
+{
+    for (auto iter = m_prefixRefs.cbegin(); iter != m_prefixRefs.cend(); ++iter)
+        m_connection.unregisterObject(iter.key());
+}
+
+/*!
+ \brief 将连接加入分发表，所在路径前缀未注册时向总线注册
+ \a conn 连接对象
+ \return 注册失败时返回false
+ */
+bool DSGConfigConnDispatcher::addConn(DSGConfigConn *conn)
+{
+    const auto &path = conn->path();
+    if (auto oldConn = m_conns.value(path)) {
+        if (oldConn == conn)
+            return true;
+        removeConn(oldConn);
+    }
+
+    const auto &prefix = pathPrefix(path);
+    int &refCount = m_prefixRefs[prefix];
+    if (refCount <= 0 && !m_connection.registerVirtualObject(prefix, this, QDBusConnection::SubPath)) {
+        m_prefixRefs.remove(prefix);
+        qCWarning(cfLog) << "Can't register the object prefix:" << prefix << m_connection.lastError().message();
+        return false;
+    }
+    ++refCount;
+    m_conns.insert(path, conn);
+
+    connect(conn, &DSGConfigConn::valueChanged, this, [this, path](const QString &key) {
+        sendValueChanged(path, key);
+    });
+    connect(conn, &QObject::destroyed, this, [this, path, conn]() {
+        if (m_conns.value(path) == conn)
+            removePath(path);
+    });
+    return true;
+}
+
+void DSGConfigConnDispatcher::removeConn(DSGConfigConn *conn)
+{
+    const auto &path = conn->path();
+    if (m_conns.value(path) != conn)
+        return;
+
+    disconnect(conn, nullptr, this, nullptr);
+    removePath(path);
+}
+
+DSGConfigConn *DSGConfigConnDispatcher::conn(const QString &path) const
+{
+    return m_conns.value(path);
+}
+
+int DSGConfigConnDispatcher::connSize() const
+{
+    return m_conns.size();
+}
+
+void DSGConfigConnDispatcher::removePath(const QString &path)
+{
+    if (!m_conns.remove(path))
+        return;
+
+    const auto &prefix = pathPrefix(path);
+    auto iter = m_prefixRefs.find(prefix);
+    if (iter == m_prefixRefs.end())
+        return;
+
+    if (--iter.value() <= 0) {
+        m_prefixRefs.erase(iter);
+        m_connection.unregisterObject(prefix);
+    }
+}
+
+/*!
+ \brief 返回指定路径的内省数据
+ 连接所在路径返回`org.desktopspec.ConfigManager.Manager`接口，中间路径返回其子节点。
+ */
+QString DSGConfigConnDispatcher::introspect(const QString &path) const
+{
+    QString xml;
+    if (m_conns.contains(path))
+        xml += managerInterfaceXml();
+
+    const QString prefix = path.endsWith('/') ? path : path + '/';
+    QSet<QString> children;
+    for (auto iter = m_conns.cbegin(); iter != m_conns.cend(); ++iter) {
+        if (iter.key().startsWith(prefix))
+            children.insert(iter.key().mid(prefix.size()).section('/', 0, 0));
+    }
+    for (const auto &child : children)
+        xml += QString("  <node name=\"%1\"/>\n").arg(child);
+
+    return xml;
+}
+
+/*!
+ \brief 分发D-Bus调用
+ `Introspectable`及`Peer`接口的调用返回false，由Qt处理。
+ */
+bool DSGConfigConnDispatcher::handleMessage(const QDBusMessage &message, const QDBusConnection &connection)
+{
+    auto conn = m_conns.value(message.path());
+    if (!conn)
+        return false;
+
+    const auto &interface = message.interface();
+    if (interface == PropertiesInterface)
+        return handlePropertiesCall(conn, message, connection);
+
+    if (interface.isEmpty() || interface == ManagerInterface)
+        return handleManagerCall(conn, message, connection);
+
+    return false;
+}
+
+bool DSGConfigConnDispatcher::handleManagerCall(DSGConfigConn *conn, const QDBusMessage &message, const QDBusConnection &connection)
+{
+    const auto &methods = managerMethods();
+    auto method = methods.constFind(message.member());
+    if (method == methods.constEnd() || method->signature != message.signature()) {
+        if (message.interface().isEmpty())
+            return false;
+
+        const auto &errorMsg = QString("No such method '%1' in interface '%2' at object path '%3' (signature '%4')")
+                .arg(message.member(), ManagerInterface, message.path(), message.signature());
+        connection.send(message.createErrorReply(QDBusError::UnknownMethod, errorMsg));
+        return true;
+    }
+
+    DSGConfigCallContext context{message, connection, QDBusMessage()};
+    conn->setCallContext(&context);
+    const auto &result = method->invoke(conn, message.arguments());
+    conn->setCallContext(nullptr);
+
+    if (context.errorReply.type() == QDBusMessage::ErrorMessage) {
+        connection.send(context.errorReply);
+    } else if (message.isReplyRequired()) {
+        connection.send(message.createReply(result));
+    }
+    return true;
+}
+
+bool DSGConfigConnDispatcher::handlePropertiesCall(DSGConfigConn *conn, const QDBusMessage &message, const QDBusConnection &connection)
+{
+    const auto &arguments = message.arguments();
+    const auto &member = message.member();
+    const bool isGet = member == QLatin1String("Get") && message.signature() == QLatin1String("ss");
+    const bool isGetAll = member == QLatin1String("GetAll") && message.signature() == QLatin1String("s");
+    const bool isSet = member == QLatin1String("Set") && message.signature() == QLatin1String("ssv");
+    if (!isGet && !isGetAll && !isSet)
+        return false;
+
+    const auto &interface = arguments.at(0).toString();
+    if (!interface.isEmpty() && interface != ManagerInterface) {
+        connection.send(message.createErrorReply(QDBusError::UnknownInterface,
+                                                 QString("Interface %1 was not found in object %2").arg(interface, message.path())));
+        return true;
+    }
+
+    if (isGetAll) {
+        const QVariantMap properties {
+            {QStringLiteral("version"), conn->version()},
+            {QStringLiteral("keyList"), conn->keyList()},
+        };
+        connection.send(message.createReply(QVariant::fromValue(properties)));
+        return true;
+    }
+
+    const auto &property = arguments.at(1).toString();
+    QVariant value;
+    if (property == QLatin1String("version")) {
+        value = conn->version();
+    } else if (property == QLatin1String("keyList")) {
+        value = conn->keyList();
+    } else {
+        connection.send(message.createErrorReply(QDBusError::UnknownProperty,
+                                                 QString("Property %1%2%3 was not found in object %4")
+                                                 .arg(interface, interface.isEmpty() ? QString() : QStringLiteral("."), property, message.path())));
+        return true;
+    }
+
+    if (isSet) {
+        connection.send(message.createErrorReply(QDBusError::PropertyReadOnly,
+                                                 QString("Property %1 is read-only").arg(property)));
+        return true;
+    }
+
+    connection.send(message.createReply(QVariant::fromValue(QDBusVariant(value))));
+    return true;
+}
+
+void DSGConfigConnDispatcher::sendValueChanged(const QString &path, const QString &key)
+{
+    auto signal = QDBusMessage::createSignal(path, ManagerInterface, QStringLiteral("valueChanged"));
+    signal << key;
+    m_connection.send(signal);
+}
@@ -0,0 +1,44 @@
+// SPDX-FileCopyrightText: 2026 Uniontech Software Technology Co.,Ltd.
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#pragma once
+
+#include "dconfig_global.h"
+#include <QHash>
+#include <QDBusConnection>
+#include <QDBusVirtualObject>
+
+class DSGConfigConn;
+/**
+ * @brief The DSGConfigConnDispatcher class
+ * 所有连接共用的D-Bus对象，按对象路径将`org.desktopspec.ConfigManager.Manager`接口的调用分发到对应的连接，
+ * 对象路径与每个连接单独注册时保持一致，按路径的第一级注册，同一前缀只注册一次。
+ */
+class DSGConfigConnDispatcher : public QDBusVirtualObject
+{
+    Q_OBJECT
+public:
+    explicit DSGConfigConnDispatcher(const QDBusConnection &connection, QObject *parent = nullptr);
+    virtual ~DSGConfigConnDispatcher() override;
+
+    bool addConn(DSGConfigConn *conn);
+    void removeConn(DSGConfigConn *conn);
+    DSGConfigConn *conn(const QString &path) const;
+    int connSize() const;
+
+    virtual QString introspect(const QString &path) const override;
+    virtual bool handleMessage(const QDBusMessage &message, const QDBusConnection &connection) override;
+
+private:
+    void removePath(const QString &path);
+    bool handleManagerCall(DSGConfigConn *conn, const QDBusMessage &message, const QDBusConnection &connection);
+    bool handlePropertiesCall(DSGConfigConn *conn, const QDBusMessage &message, const QDBusConnection &connection);
+    void sendValueChanged(const QString &path, const QString &key);
+
+private:
+    QDBusConnection m_connection;
+    QHash<QString, DSGConfigConn *> m_conns;
+    // 已注册的路径前缀及其下的连接数量
+    QHash<QString, int> m_prefixRefs;
+};
@@ -0,0 +1,103 @@
+// SPDX-FileCopyrightText: 2026 Uniontech Software Technology Co.,Ltd.
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#include "dconfigcredentials.h"
+#include <QDBusArgument>
+#include <QDBusMessage>
+#include <QDBusConnectionInterface>
+#include <QDebug>
+
+/*!
+ \brief 设置缓存服务时的回调，在回调中监控服务，服务退出时调用remove
+ */
+void ServiceCredentialCache::setWatchHandler(const WatchHandler &handler)
+{
+    m_watchHandler = handler;
+}
+
+/*!
+ \brief 获取服务的凭证信息，优先使用缓存
+ \a connection 服务所在的总线
+ \a service 服务名称
+ \return 获取失败时返回空
+ */
+std::optional<ServiceCredential> ServiceCredentialCache::credential(const QDBusConnection &connection, const ConnServiceName &service)
+{
+    auto iter = m_credentials.constFind(service);
+    if (iter != m_credentials.constEnd())
+        return iter.value();
+
+    const auto credential = query(connection, service);
+    // an unwatched entry is never removed, the unique name isn't reused.
+    if (credential && m_watchHandler) {
+        m_credentials.insert(service, *credential);
+        m_watchHandler(connection, service, *credential);
+    }
+
+    return credential;
+}
+
+void ServiceCredentialCache::remove(const ConnServiceName &service)
+{
+    m_credentials.remove(service);
+}
+
+void ServiceCredentialCache::clear()
+{
+    m_credentials.clear();
+}
+
+int ServiceCredentialCache::size() const
+{
+    return m_credentials.size();
+}
+
+/*!
+ \brief 向dbus-daemon查询服务的凭证信息，不使用缓存
+ 一次`GetConnectionCredentials`调用同时获得uid和pid，不支持此方法时回退到`GetConnectionUnixUser`和`GetConnectionUnixProcessID`。
+ */
+std::optional<ServiceCredential> ServiceCredentialCache::query(const QDBusConnection &connection, const ConnServiceName &service)
+{
+    ServiceCredential credential;
+    bool hasUid = false;
+    bool hasPid = false;
+
+    QDBusMessage msg = QDBusMessage::createMethodCall(QStringLiteral("org.freedesktop.DBus"),
+                                                      QStringLiteral("/org/freedesktop/DBus"),
+                                                      QStringLiteral("org.freedesktop.DBus"),
+                                                      QStringLiteral("GetConnectionCredentials"));
+    msg << service;
+    const QDBusMessage reply = connection.call(msg);
+    if (reply.type() == QDBusMessage::ReplyMessage && !reply.arguments().isEmpty()) {
+        const auto credentials = qdbus_cast<QVariantMap>(reply.arguments().constFirst());
+        const auto uid = credentials.value(QStringLiteral("UnixUserID"));
+        const auto pid = credentials.value(QStringLiteral("ProcessID"));
+        if (uid.isValid()) {
+            credential.uid = uid.toUInt(&hasUid);
+        }
+        if (pid.isValid()) {
+            credential.pid = pid.toUInt(&hasPid);
+        }
+    }
+
+    if (!hasUid) {
+        const auto uidReply = connection.interface()->serviceUid(service);
+        if (!uidReply.isValid()) {
+            qCWarning(cfLog) << "Can't get uid of the service:" << service << uidReply.error().message();
+            return std::nullopt;
+        }
+        credential.uid = uidReply.value();
+    }
+    if (!hasPid) {
+        const auto pidReply = connection.interface()->servicePid(service);
+        if (!pidReply.isValid()) {
+            qCWarning(cfLog) << "Can't get pid of the service:" << service << pidReply.error().message();
+            return std::nullopt;
+        }
+        credential.pid = pidReply.value();
+    }
+
+    credential.processName = getProcessNameByPid(credential.pid);
+    return credential;
+}
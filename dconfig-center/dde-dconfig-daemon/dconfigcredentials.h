@@ -0,0 +1,43 @@
+// SPDX-FileCopyrightText: 2026 Uniontech Software Technology Co.,Ltd.
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#pragma once
+
+#include "dconfig_global.h"
+#include <functional>
+#include <optional>
+#include <QHash>
+#include <QDBusConnection>
+
+struct ServiceCredential
+{
+    uint uid = 0;
+    uint pid = 0;
+    QString processName;
+};
+
+/**
+ * @brief The ServiceCredentialCache class
+ * 缓存D-Bus调用者(unique name)的凭证信息，包括uid、pid及进程名，
+ * 首次访问时通过`GetConnectionCredentials`获取，服务退出时由服务监控移除。
+ * 缓存的服务都交给服务监控，未设置服务监控时不缓存，避免未获取配置的调用者一直留在缓存中。
+ */
+class ServiceCredentialCache
+{
+public:
+    using WatchHandler = std::function<void(const QDBusConnection &connection, const ConnServiceName &service,
+                                            const ServiceCredential &credential)>;
+    void setWatchHandler(const WatchHandler &handler);
+
+    std::optional<ServiceCredential> credential(const QDBusConnection &connection, const ConnServiceName &service);
+    void remove(const ConnServiceName &service);
+    void clear();
+    int size() const;
+
+    static std::optional<ServiceCredential> query(const QDBusConnection &connection, const ConnServiceName &service);
+
+private:
+    QHash<ConnServiceName, ServiceCredential> m_credentials;
+    WatchHandler m_watchHandler;
+};
@@ -0,0 +1,308 @@
+// SPDX-FileCopyrightText: 2026 Uniontech Software Technology Co.,Ltd.
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#include "dconfigjournal.h"
+#include "dconfig_global.h"
+
+#include <QDataStream>
+#include <QDir>
+#include <QFileInfo>
+#include <QSaveFile>
+
+#include <algorithm>
+
+// 记录的最大长度，超出时认为日志已损坏
+static constexpr quint32 MaxRecordSize = 16 * 1024 * 1024;
+
+static quint16 recordChecksum(const QByteArray &payload)
+{
+#if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
+    return qChecksum(payload);
+#else
+    return qChecksum(payload.constData(), static_cast<uint>(payload.size()));
+#endif
+}
+
+static QByteArray encodeRecord(const DSGConfigJournal::Record &record)
+{
+    QByteArray payload;
+    QDataStream stream(&payload, QIODevice::WriteOnly);
+    stream.setVersion(QDataStream::Qt_5_11);
+    stream << static_cast<quint8>(record.global) << record.appid.toUtf8() << static_cast<quint32>(record.uid)
+           << record.key.toUtf8() << static_cast<qint32>(record.serial) << record.value;
+
+    QByteArray frame;
+    QDataStream frameStream(&frame, QIODevice::WriteOnly);
+    frameStream.setVersion(QDataStream::Qt_5_11);
+    frameStream << static_cast<quint32>(payload.size());
+    frameStream.writeRawData(payload.constData(), payload.size());
+    frameStream << recordChecksum(payload);
+    return frame;
+}
+
+void DSGConfigJournal::setPath(const QString &path)
+{
+    if (m_path == path)
+        return;
+
+    m_file.close();
+    m_path = path;
+    m_size = -1;
+    m_firstRecordTime.invalidate();
+    const auto &existingSegments = segments(m_path);
+    m_lastSegment = existingSegments.isEmpty() ? 0 : existingSegments.last();
+}
+
+QString DSGConfigJournal::path() const
+{
+    return m_path;
+}
+
+/*!
+ \brief 追加一条记录，只写入系统缓冲，不等待写入磁盘
+ \return 日志文件无法写入时返回false
+ */
+bool DSGConfigJournal::append(const Record &record)
+{
+    if (!openForAppend())
+        return false;
+
+    const auto &frame = encodeRecord(record);
+    if (m_file.write(frame) != frame.size() || !m_file.flush()) {
+        qCWarning(cfLog) << "Can't write the journal:" << m_path << m_file.errorString();
+        m_file.close();
+        m_size = -1;
+        return false;
+    }
+    if (m_size <= 0)
+        m_firstRecordTime.start();
+    m_size += frame.size();
+    return true;
+}
+
+/*!
+ \brief 按写入顺序读取日志段及当前日志中所有完整的记录
+ */
+QList<DSGConfigJournal::Record> DSGConfigJournal::read() const
+{
+    QList<Record> records;
+    for (const auto segment : segments(m_path))
+        records << read(QString("%1.%2").arg(m_path).arg(segment));
+    records << read(m_path);
+    return records;
+}
+
+QList<DSGConfigJournal::Record> DSGConfigJournal::read(const QString &path)
+{
+    QList<Record> records;
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly))
+        return records;
+
+    QDataStream frameStream(&file);
+    frameStream.setVersion(QDataStream::Qt_5_11);
+    while (!frameStream.atEnd()) {
+        quint32 size = 0;
+        frameStream >> size;
+        if (frameStream.status() != QDataStream::Ok || size > MaxRecordSize)
+            break;
+
+        QByteArray payload(static_cast<int>(size), Qt::Uninitialized);
+        quint16 checksum = 0;
+        if (frameStream.readRawData(payload.data(), payload.size()) != payload.size())
+            break;
+        frameStream >> checksum;
+        if (frameStream.status() != QDataStream::Ok
+                || checksum != recordChecksum(payload)) {
+            break;
+        }
+
+        QDataStream stream(payload);
+        stream.setVersion(QDataStream::Qt_5_11);
+        Record record;
+        quint8 global = 0;
+        QByteArray appid, key;
+        quint32 uid = 0;
+        qint32 serial = -1;
+        stream >> global >> appid >> uid >> key >> serial >> record.value;
+        if (stream.status() != QDataStream::Ok)
+            break;
+
+        record.global = global;
+        record.appid = QString::fromUtf8(appid);
+        record.uid = uid;
+        record.key = QString::fromUtf8(key);
+        record.serial = serial;
+        records << record;
+    }
+    if (!frameStream.atEnd())
+        qCWarning(cfLog) << "Ignore the incomplete records of the journal:" << path;
+
+    return records;
+}
+
+/*!
+ \brief 记录已合并到缓存文件后清空日志及所有日志段
+ */
+void DSGConfigJournal::clear()
+{
+    m_file.close();
+    m_firstRecordTime.invalidate();
+    m_size = 0;
+    if (QFile::exists(m_path) && !QFile::remove(m_path)) {
+        qCWarning(cfLog) << "Can't remove the journal:" << m_path;
+        m_size = -1;
+    }
+    removeSegments(m_path, m_lastSegment);
+}
+
+/*!
+ \brief 将当前日志轮转为日志段，之后的记录写入新的日志
+ \return 最后一个日志段的序号，日志为空时不轮转，没有日志段时返回0
+ */
+quint64 DSGConfigJournal::rotate()
+{
+    m_file.close();
+    if (QFileInfo(m_path).size() <= 0)
+        return m_lastSegment;
+
+    const auto segment = m_lastSegment + 1;
+    if (!QFile::rename(m_path, QString("%1.%2").arg(m_path).arg(segment))) {
+        qCWarning(cfLog) << "Can't rotate the journal:" << m_path;
+        return m_lastSegment;
+    }
+    m_lastSegment = segment;
+    m_size = 0;
+    m_firstRecordTime.invalidate();
+    return m_lastSegment;
+}
+
+QList<quint64> DSGConfigJournal::segments() const
+{
+    return segments(m_path);
+}
+
+/*!
+ \brief 删除日志中记录的缓存保存完成后，删除此序号及之前的日志段
+ */
+void DSGConfigJournal::removeSegments(const QString &path, const quint64 last)
+{
+    for (const auto segment : segments(path)) {
+        if (segment > last)
+            break;
+
+        const auto &segmentPath = QString("%1.%2").arg(path).arg(segment);
+        if (!QFile::remove(segmentPath))
+            qCWarning(cfLog) << "Can't remove the journal:" << segmentPath;
+    }
+}
+
+/*!
+ \brief 删除日志及日志段中此用户的用户缓存记录，全局缓存的记录保留，
+ 之后的记录写入重写后的日志
+ \return 无法重写日志时返回false
+ */
+bool DSGConfigJournal::removeUserRecords(const uint uid)
+{
+    // the rewritten journal is a new file, reopen it for the later records.
+    m_file.close();
+    m_size = -1;
+    return removeUserRecords(m_path, uid);
+}
+
+bool DSGConfigJournal::removeUserRecords(const QString &path, const uint uid)
+{
+    if (path.isEmpty())
+        return true;
+
+    QStringList paths;
+    for (const auto segment : segments(path))
+        paths << QString("%1.%2").arg(path).arg(segment);
+    paths << path;
+
+    bool result = true;
+    for (const auto &journalPath : paths) {
+        if (!QFile::exists(journalPath))
+            continue;
+
+        QByteArray content;
+        bool removed = false;
+        for (const auto &record : read(journalPath)) {
+            if (!record.global && record.uid == uid) {
+                removed = true;
+                continue;
+            }
+            content += encodeRecord(record);
+        }
+        if (!removed)
+            continue;
+
+        QSaveFile file(journalPath);
+        if (!file.open(QIODevice::WriteOnly) || file.write(content) != content.size() || !file.commit()) {
+            qCWarning(cfLog) << "Can't remove the records of the user:" << uid << "from the journal:" << journalPath;
+            result = false;
+        }
+    }
+    return result;
+}
+
+QList<quint64> DSGConfigJournal::segments(const QString &path)
+{
+    QList<quint64> result;
+    if (path.isEmpty())
+        return result;
+
+    const QFileInfo info(path);
+    const auto &prefix = info.fileName() + '.';
+    const auto &names = QDir(info.path()).entryList(QStringList() << prefix + '*', QDir::Files);
+    for (const auto &name : names) {
+        bool ok = false;
+        const auto segment = name.mid(prefix.size()).toULongLong(&ok);
+        if (ok && segment > 0)
+            result << segment;
+    }
+    std::sort(result.begin(), result.end());
+    return result;
+}
+
+bool DSGConfigJournal::isEmpty() const
+{
+    return size() <= 0 && segments().isEmpty();
+}
+
+/*!
+ \brief 当前日志的大小，不包含日志段
+ */
+qint64 DSGConfigJournal::size() const
+{
+    return m_size >= 0 ? m_size : QFileInfo(m_path).size();
+}
+
+/*!
+ \brief 第一条未合并的记录写入后经过的时间
+ \return 毫秒，没有记录时返回-1
+ */
+qint64 DSGConfigJournal::age() const
+{
+    return m_firstRecordTime.isValid() ? m_firstRecordTime.elapsed() : -1;
+}
+
+bool DSGConfigJournal::openForAppend()
+{
+    if (m_file.isOpen())
+        return true;
+
+    if (m_path.isEmpty() || !QDir().mkpath(QFileInfo(m_path).path()))
+        return false;
+
+    m_file.setFileName(m_path);
+    if (!m_file.open(QIODevice::WriteOnly | QIODevice::Append)) {
+        qCWarning(cfLog) << "Can't open the journal:" << m_path << m_file.errorString();
+        return false;
+    }
+    m_size = m_file.size();
+    if (m_size > 0 && !m_firstRecordTime.isValid())
+        m_firstRecordTime.start();
+    return true;
+}
@@ -0,0 +1,70 @@
+// SPDX-FileCopyrightText: 2026 Uniontech Software Technology Co.,Ltd.
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#pragma once
+
+#include <QElapsedTimer>
+#include <QFile>
+#include <QList>
+#include <QString>
+#include <QVariant>
+
+/**
+ * @brief The DSGConfigJournal class
+ * 资源的追加日志，每次修改配置项只追加一条记录（缓存、配置项、序列号及修改后的值），
+ * 不再重写整个缓存文件，合并到缓存文件后清空。
+ * 记录带有长度及校验和，服务异常退出时末尾不完整的记录被忽略。
+ * 合并时当前日志轮转为带序号的日志段，新的记录写入新的日志，日志段在缓存保存完成后删除。
+ */
+class DSGConfigJournal
+{
+public:
+    struct Record {
+        bool global = false;
+        // 内部的应用ID
+        QString appid;
+        // 用户缓存的用户，全局缓存为修改配置项的用户
+        uint uid = 0;
+        QString key;
+        int serial = -1;
+        // 无效时表示配置项被重置
+        QVariant value;
+    };
+
+    DSGConfigJournal() = default;
+    DSGConfigJournal(const DSGConfigJournal &) = delete;
+    DSGConfigJournal &operator=(const DSGConfigJournal &) = delete;
+
+    void setPath(const QString &path);
+    QString path() const;
+
+    bool append(const Record &record);
+    QList<Record> read() const;
+    void clear();
+
+    quint64 rotate();
+    QList<quint64> segments() const;
+    static void removeSegments(const QString &path, const quint64 last);
+
+    bool removeUserRecords(const uint uid);
+    static bool removeUserRecords(const QString &path, const uint uid);
+
+    bool isEmpty() const;
+    qint64 size() const;
+    qint64 age() const;
+
+private:
+    bool openForAppend();
+    static QList<quint64> segments(const QString &path);
+    static QList<Record> read(const QString &path);
+
+private:
+    QString m_path;
+    QFile m_file;
+    qint64 m_size = -1;
+    // 最后一个轮转出的日志段的序号
+    quint64 m_lastSegment = 0;
+    // 上次清空后第一条记录的时间
+    QElapsedTimer m_firstRecordTime;
+};
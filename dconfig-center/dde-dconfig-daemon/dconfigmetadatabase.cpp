@@ -0,0 +1,392 @@
+// SPDX-FileCopyrightText: 2026 Uniontech Software Technology Co.,Ltd.
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#include "dconfigmetadatabase.h"
+#include "dconfig_global.h"
+
+#include <QBuffer>
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSaveFile>
+#include <QtEndian>
+#include <DConfigFile>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+DCORE_USE_NAMESPACE
+
+static constexpr quint32 DatabaseMagic = 0x44434d44; // "DCMD"
+static constexpr quint32 DatabaseVersion = 2;
+
+DSGConfigMetaDatabase::~DSGConfigMetaDatabase()
+{
+    close();
+}
+
+/*!
+ \brief 编译描述文件数据库，由软件包安装后的触发器调用
+ \a path 数据库文件
+ \a roots 描述文件及override目录，其中所有文件的签名写入数据库
+ 描述文件目录中的每个配置，按应用目录及子目录通过DConfigFile加载，保存原始的描述文件及生效值的差异
+ */
+bool DSGConfigMetaDatabase::compile(const QString &path, const QString &localPrefix, const QStringList &roots)
+{
+    DSGConfigSignatureIndex index;
+    index.scan(roots, false);
+    QStringList files = index.filePaths();
+    files.sort();
+
+    // `$metaDir/$appid/[$subpath/]$resource.json` is also the generic configuration of the subpath `/$appid/[$subpath]`.
+    struct Candidate {
+        QString appid;
+        QString resource;
+        QString subpath;
+    };
+    QList<Candidate> candidates;
+    for (const auto &file : std::as_const(files)) {
+        const auto &id = getMetaConfigureId(file);
+        if (id.isInValid())
+            continue;
+
+        if (id.appid.isEmpty()) {
+            candidates << Candidate{QString(), id.resource, QString()};
+            continue;
+        }
+        candidates << Candidate{id.appid, id.resource, normalizeSubpath(id.subpath)};
+        candidates << Candidate{QString(), id.resource, normalizeSubpath(id.appid + '/' + id.subpath)};
+    }
+
+    QByteArray data;
+    QHash<QString, Entry> entries;
+    // the same content is stored once, e.g. the meta shared by subpaths and appids.
+    QHash<QByteArray, Blob> blobs;
+    const auto appendBlob = [&data, &blobs](const QByteArray &content) {
+        if (content.isEmpty())
+            return Blob();
+
+        const auto &digest = QCryptographicHash::hash(content, QCryptographicHash::Sha1);
+        auto iter = blobs.constFind(digest);
+        if (iter != blobs.constEnd())
+            return iter.value();
+
+        const Blob blob{static_cast<quint64>(data.size()), static_cast<quint32>(content.size())};
+        data.append(content);
+        blobs.insert(digest, blob);
+        return blob;
+    };
+    for (const auto &candidate : std::as_const(candidates)) {
+        const auto &key = entryKey(candidate.appid, candidate.resource, candidate.subpath);
+        if (entries.contains(key))
+            continue;
+
+        const auto &meta = compileMeta(candidate.appid, candidate.resource, candidate.subpath, localPrefix);
+        if (!meta.isValid()) {
+            qCWarning(cfLog) << "Can't compile the configuration, appid:" << candidate.appid
+                             << "resource:" << candidate.resource << "subpath:" << candidate.subpath;
+            continue;
+        }
+        entries.insert(key, Entry{appendBlob(meta.meta), appendBlob(meta.override)});
+    }
+
+    QByteArray header;
+    QDataStream stream(&header, QIODevice::WriteOnly);
+    stream.setVersion(QDataStream::Qt_5_11);
+    stream << DatabaseMagic << DatabaseVersion;
+    stream << static_cast<quint32>(files.size());
+    for (const auto &file : std::as_const(files)) {
+        const auto &signature = DSGConfigSignatureIndex::fileSignature(file);
+        stream << file << signature.size << signature.changeTime;
+    }
+    stream << static_cast<quint32>(entries.size());
+    for (auto iter = entries.cbegin(); iter != entries.cend(); ++iter) {
+        stream << iter.key() << iter.value().meta.offset << iter.value().meta.size
+               << iter.value().override.offset << iter.value().override.size;
+    }
+
+    if (!QDir().mkpath(QFileInfo(path).path()))
+        return false;
+
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qCWarning(cfLog) << "Can't write the meta database:" << path << file.errorString();
+        return false;
+    }
+    const quint32 headerSize = qToBigEndian<quint32>(static_cast<quint32>(header.size()));
+    file.write(reinterpret_cast<const char *>(&headerSize), sizeof(headerSize));
+    file.write(header);
+    file.write(data);
+    if (!file.commit()) {
+        qCWarning(cfLog) << "Can't write the meta database:" << path << file.errorString();
+        return false;
+    }
+    QFile::setPermissions(path, QFile::ReadOwner | QFile::WriteOwner | QFile::ReadGroup | QFile::ReadOther);
+    qCInfo(cfLog) << "Compiled the meta database:" << path << ", configurations:" << entries.size()
+                  << ", distinct documents:" << blobs.size() << ", bytes:" << data.size()
+                  << ", source files:" << files.size();
+    return true;
+}
+
+/*!
+ \brief 以只读方式映射数据库文件
+ \return 文件不存在或格式不匹配时返回false
+ */
+bool DSGConfigMetaDatabase::open(const QString &path)
+{
+    close();
+
+    const int fd = ::open(QFile::encodeName(path).constData(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return false;
+
+    struct stat info;
+    if (fstat(fd, &info) != 0 || info.st_size < static_cast<off_t>(sizeof(quint32))) {
+        ::close(fd);
+        return false;
+    }
+    void *data = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (data == MAP_FAILED)
+        return false;
+
+    m_data = static_cast<uchar *>(data);
+    m_size = info.st_size;
+
+    const quint32 headerSize = qFromBigEndian<quint32>(m_data);
+    const qint64 dataOffset = static_cast<qint64>(sizeof(quint32)) + headerSize;
+    if (dataOffset > m_size) {
+        close();
+        return false;
+    }
+    const auto &header = QByteArray::fromRawData(reinterpret_cast<const char *>(m_data) + sizeof(quint32),
+                                                 static_cast<int>(headerSize));
+    QDataStream stream(header);
+    stream.setVersion(QDataStream::Qt_5_11);
+    quint32 magic = 0, version = 0;
+    stream >> magic >> version;
+    if (magic != DatabaseMagic || version != DatabaseVersion) {
+        qCWarning(cfLog) << "The meta database's version isn't supported:" << path;
+        close();
+        return false;
+    }
+
+    quint32 count = 0;
+    stream >> count;
+    for (quint32 i = 0; i < count && stream.status() == QDataStream::Ok; ++i) {
+        Source source;
+        stream >> source.path >> source.signature.size >> source.signature.changeTime;
+        m_sources << source;
+    }
+    stream >> count;
+    for (quint32 i = 0; i < count && stream.status() == QDataStream::Ok; ++i) {
+        QString key;
+        Entry entry;
+        stream >> key >> entry.meta.offset >> entry.meta.size >> entry.override.offset >> entry.override.size;
+        for (auto blob : {&entry.meta, &entry.override}) {
+            blob->offset += static_cast<quint64>(dataOffset);
+            if (blob->offset + blob->size > static_cast<quint64>(m_size))
+                stream.setStatus(QDataStream::ReadCorruptData);
+        }
+        m_entries.insert(key, entry);
+    }
+    if (stream.status() != QDataStream::Ok) {
+        qCWarning(cfLog) << "The meta database is corrupted:" << path;
+        close();
+        return false;
+    }
+    return true;
+}
+
+void DSGConfigMetaDatabase::close()
+{
+    if (m_data)
+        munmap(m_data, static_cast<size_t>(m_size));
+
+    m_data = nullptr;
+    m_size = 0;
+    m_sources.clear();
+    m_entries.clear();
+}
+
+bool DSGConfigMetaDatabase::isOpen() const
+{
+    return m_data != nullptr;
+}
+
+/*!
+ \brief 数据库是否与当前的配置文件一致，文件列表与index相同且每个文件的签名与编译时相同
+ \a index 配置目录的文件签名，其中的文件签名可能未更新，重新读取每个文件的签名
+ */
+bool DSGConfigMetaDatabase::isUpToDate(const DSGConfigSignatureIndex &index) const
+{
+    if (!isOpen() || index.size() != m_sources.size())
+        return false;
+
+    for (const auto &source : m_sources) {
+        if (!index.contains(source.path) || DSGConfigSignatureIndex::fileSignature(source.path) != source.signature)
+            return false;
+    }
+    return true;
+}
+
+void DSGConfigMetaDatabase::swap(DSGConfigMetaDatabase &other)
+{
+    std::swap(m_data, other.m_data);
+    std::swap(m_size, other.m_size);
+    m_sources.swap(other.m_sources);
+    m_entries.swap(other.m_entries);
+}
+
+/*!
+ \brief 获取描述文件及需要叠加的override内容，数据在数据库关闭前有效
+ \a appid 应用ID，公共配置为空
+ \return 数据库中不存在时返回无效的结果
+ */
+DSGConfigMetaDatabase::Meta DSGConfigMetaDatabase::meta(const QString &appid, const QString &resource, const QString &subpath) const
+{
+    auto iter = m_entries.constFind(entryKey(appid, resource, subpath));
+    if (iter == m_entries.constEnd())
+        return Meta();
+
+    const auto blobData = [this](const Blob &blob) {
+        if (blob.size == 0)
+            return QByteArray();
+        return QByteArray::fromRawData(reinterpret_cast<const char *>(m_data) + blob.offset, static_cast<int>(blob.size));
+    };
+    return Meta{blobData(iter->meta), blobData(iter->override)};
+}
+
+int DSGConfigMetaDatabase::size() const
+{
+    return m_entries.size();
+}
+
+QString DSGConfigMetaDatabase::entryKey(const QString &appid, const QString &resource, const QString &subpath)
+{
+    return QString("%1\n%2\n%3").arg(appid, resource, normalizeSubpath(subpath));
+}
+
+// `a/b`、`/a/b/`与`/a/b`为同一个子目录
+QString DSGConfigMetaDatabase::normalizeSubpath(const QString &subpath)
+{
+    const auto &sections = subpath.split('/', Qt::SkipEmptyParts);
+    return sections.isEmpty() ? QString() : '/' + sections.join('/');
+}
+
+/*
+  \internal
+
+    \breaf 比较两个描述文件中所有配置项的值及属性
+*/
+static bool isSameMeta(DConfigMeta *meta, DConfigMeta *other)
+{
+    auto keys = meta->keyList();
+    auto otherKeys = other->keyList();
+    keys.sort();
+    otherKeys.sort();
+    if (keys != otherKeys)
+        return false;
+
+    for (const auto &key : std::as_const(keys)) {
+        if (meta->value(key) != other->value(key)
+                || meta->permissions(key) != other->permissions(key)
+                || meta->visibility(key) != other->visibility(key)
+                || meta->flags(key) != other->flags(key)
+                || meta->serial(key) != other->serial(key)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool loadMeta(DConfigMeta *meta, const QByteArray &content, const QByteArray &override)
+{
+    QBuffer metaBuffer;
+    metaBuffer.setData(content);
+    QBuffer overrideBuffer;
+    overrideBuffer.setData(override);
+    if (!metaBuffer.open(QIODevice::ReadOnly) || !overrideBuffer.open(QIODevice::ReadOnly))
+        return false;
+
+    QList<QIODevice *> overrides;
+    if (!override.isEmpty())
+        overrides << &overrideBuffer;
+    return meta->load(&metaBuffer, overrides);
+}
+
+/*
+  \internal
+
+    \breaf 通过DConfigFile查找并加载描述文件及override，得到原始的描述文件及一个只包含差异的override，
+    差异包括生效的值、权限及序列号，相同的描述文件在数据库中只保存一次；
+    叠加后与DConfigFile加载的结果不一致时，使用合并了所有属性的描述文件
+*/
+DSGConfigMetaDatabase::Meta DSGConfigMetaDatabase::compileMeta(const QString &appid, const QString &resource,
+                                                               const QString &subpath, const QString &localPrefix)
+{
+    DConfigFile file(appid, resource, subpath);
+    auto meta = file.meta();
+    if (!meta->load(localPrefix))
+        return Meta();
+
+    QFile metaFile(meta->metaPath(localPrefix));
+    if (!metaFile.open(QIODevice::ReadOnly))
+        return Meta();
+
+    const QByteArray content = metaFile.readAll();
+    DConfigFile base(appid, resource, subpath);
+    if (!loadMeta(base.meta(), content, QByteArray()))
+        return Meta();
+
+    QJsonObject overrideContents;
+    for (const auto &key : meta->keyList()) {
+        QJsonObject item;
+        if (meta->value(key) != base.meta()->value(key))
+            item.insert("value", QJsonValue::fromVariant(meta->value(key)));
+        if (meta->permissions(key) != base.meta()->permissions(key))
+            item.insert("permissions", meta->permissions(key) == DConfigFile::ReadWrite ? "readwrite" : "readonly");
+        if (meta->serial(key) != base.meta()->serial(key))
+            item.insert("serial", meta->serial(key));
+        if (!item.isEmpty())
+            overrideContents.insert(key, item);
+    }
+    QByteArray override;
+    if (!overrideContents.isEmpty()) {
+        QJsonObject root;
+        root.insert("magic", "dsg.config.override");
+        root.insert("version", "1.0");
+        root.insert("contents", overrideContents);
+        override = QJsonDocument(root).toJson(QJsonDocument::Compact);
+    }
+
+    DConfigFile layered(appid, resource, subpath);
+    if (loadMeta(layered.meta(), content, override) && isSameMeta(layered.meta(), meta))
+        return Meta{content, override};
+
+    // the override can't be expressed as a delta, e.g. some attributes can't be overridden.
+    auto root = QJsonDocument::fromJson(content).object();
+    if (root.isEmpty())
+        return Meta();
+
+    auto contents = root.value("contents").toObject();
+    for (const auto &key : meta->keyList()) {
+        auto item = contents.value(key).toObject();
+        item.insert("value", QJsonValue::fromVariant(meta->value(key)));
+        item.insert("permissions", meta->permissions(key) == DConfigFile::ReadWrite ? "readwrite" : "readonly");
+        item.insert("visibility", meta->visibility(key) == DConfigFile::Public ? "public" : "private");
+        const int serial = meta->serial(key);
+        if (serial >= 0)
+            item.insert("serial", serial);
+        contents.insert(key, item);
+    }
+    root.insert("contents", contents);
+    return Meta{QJsonDocument(root).toJson(QJsonDocument::Compact), QByteArray()};
+}
@@ -0,0 +1,72 @@
+// SPDX-FileCopyrightText: 2026 Uniontech Software Technology Co.,Ltd.
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#pragma once
+
+#include "dconfigsignatureindex.h"
+
+#include <QByteArray>
+#include <QHash>
+#include <QStringList>
+#include <QVector>
+
+/**
+ * @brief The DSGConfigMetaDatabase class
+ * 安装软件包时预先编译的描述文件数据库，每个配置为原始的描述文件及生效值的差异，相同的内容只保存一次，
+ * 服务通过mmap读取，不再查找描述文件及override目录，
+ * 数据库记录编译时所有配置文件的签名，配置文件变化后不再使用。
+ */
+class DSGConfigMetaDatabase
+{
+public:
+    DSGConfigMetaDatabase() = default;
+    ~DSGConfigMetaDatabase();
+    DSGConfigMetaDatabase(const DSGConfigMetaDatabase &) = delete;
+    DSGConfigMetaDatabase &operator=(const DSGConfigMetaDatabase &) = delete;
+
+    static bool compile(const QString &path, const QString &localPrefix, const QStringList &roots);
+
+    bool open(const QString &path);
+    void close();
+    bool isOpen() const;
+    bool isUpToDate(const DSGConfigSignatureIndex &index) const;
+    void swap(DSGConfigMetaDatabase &other);
+
+    // 描述文件及叠加在其上的override，override只包含与描述文件不同的值
+    struct Meta {
+        QByteArray meta;
+        QByteArray override;
+
+        bool isValid() const
+        {
+            return !meta.isEmpty();
+        }
+    };
+    Meta meta(const QString &appid, const QString &resource, const QString &subpath) const;
+    int size() const;
+
+private:
+    struct Source {
+        QString path;
+        DSGConfigSignatureIndex::FileSignature signature;
+    };
+    struct Blob {
+        quint64 offset = 0;
+        quint32 size = 0;
+    };
+    struct Entry {
+        Blob meta;
+        Blob override;
+    };
+    static QString entryKey(const QString &appid, const QString &resource, const QString &subpath);
+    static QString normalizeSubpath(const QString &subpath);
+    static Meta compileMeta(const QString &appid, const QString &resource, const QString &subpath,
+                            const QString &localPrefix);
+
+private:
+    uchar *m_data = nullptr;
+    qint64 m_size = 0;
+    QVector<Source> m_sources;
+    QHash<QString, Entry> m_entries;
+};
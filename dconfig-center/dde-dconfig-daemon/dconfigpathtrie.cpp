@@ -0,0 +1,95 @@
+// SPDX-FileCopyrightText: 2026 Uniontech Software Technology Co.,Ltd.
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#include "dconfigpathtrie.h"
+
+#include <QDir>
+
+/*!
+ \brief 重新建立前缀树
+ \a roots 绝对路径的目录
+ */
+void DSGConfigPathTrie::setRoots(const QStringList &roots)
+{
+    clear();
+    m_nodes.append(Node());
+    for (const auto &item : roots) {
+        const auto &root = QDir::cleanPath(item);
+        if (!root.startsWith('/'))
+            continue;
+
+        m_roots << root;
+        int current = 0;
+        forEachSection(root, [this, &current](const QString &section) {
+            auto iter = m_nodes[current].children.constFind(section);
+            if (iter != m_nodes[current].children.constEnd()) {
+                current = iter.value();
+            } else {
+                const int next = m_nodes.size();
+                m_nodes[current].children.insert(section, next);
+                m_nodes.append(Node());
+                current = next;
+            }
+            return true;
+        });
+        m_nodes[current].isRoot = true;
+    }
+}
+
+QStringList DSGConfigPathTrie::roots() const
+{
+    return m_roots;
+}
+
+void DSGConfigPathTrie::clear()
+{
+    m_roots.clear();
+    m_nodes.clear();
+}
+
+/*!
+ \brief 路径是否为某个目录或位于某个目录中
+ \a path 绝对路径，包含`..`时需先调用QDir::cleanPath
+ */
+bool DSGConfigPathTrie::contains(const QString &path) const
+{
+    if (m_nodes.isEmpty() || !path.startsWith('/'))
+        return false;
+
+    int current = 0;
+    bool matched = m_nodes.first().isRoot;
+    forEachSection(path, [this, &current, &matched](const QString &section) {
+        auto iter = m_nodes[current].children.constFind(section);
+        if (iter == m_nodes[current].children.constEnd())
+            return false;
+
+        current = iter.value();
+        matched = m_nodes[current].isRoot;
+        return !matched;
+    });
+    return matched;
+}
+
+/*
+  \internal
+
+    \breaf 依次访问路径中的目录名，跳过空的及`.`，visitor返回false时停止
+*/
+template<class Visitor>
+bool DSGConfigPathTrie::forEachSection(const QString &path, Visitor visitor)
+{
+    int begin = 0;
+    for (int i = 0; i <= path.size(); ++i) {
+        if (i < path.size() && path.at(i) != QLatin1Char('/'))
+            continue;
+
+        const int length = i - begin;
+        if (length > 0 && !(length == 1 && path.at(begin) == QLatin1Char('.'))) {
+            if (!visitor(path.mid(begin, length)))
+                return false;
+        }
+        begin = i + 1;
+    }
+    return true;
+}
@@ -0,0 +1,37 @@
+// SPDX-FileCopyrightText: 2026 Uniontech Software Technology Co.,Ltd.
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#pragma once
+
+#include <QHash>
+#include <QStringList>
+#include <QVector>
+
+/**
+ * @brief The DSGConfigPathTrie class
+ * 按路径的目录名建立的前缀树，用于判断路径是否位于某个目录中，
+ * 只比较路径字符串，不访问文件系统。
+ */
+class DSGConfigPathTrie
+{
+public:
+    void setRoots(const QStringList &roots);
+    QStringList roots() const;
+    void clear();
+
+    bool contains(const QString &path) const;
+
+private:
+    struct Node {
+        QHash<QString, int> children;
+        bool isRoot = false;
+    };
+    template<class Visitor>
+    static bool forEachSection(const QString &path, Visitor visitor);
+
+private:
+    QStringList m_roots;
+    // m_nodes[0]为`/`
+    QVector<Node> m_nodes;
+};
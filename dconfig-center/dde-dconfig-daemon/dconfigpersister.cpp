@@ -0,0 +1,333 @@
+// SPDX-FileCopyrightText: 2026 Uniontech Software Technology Co.,Ltd.
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#include "dconfigpersister.h"
+#include "dconfig_global.h"
+
+#include <DConfigFile>
+#include <QCoreApplication>
+#include <QDir>
+#include <QDirIterator>
+#include <QElapsedTimer>
+#include <QFileInfo>
+#include <QThreadPool>
+
+#include <sys/syscall.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+
+// linux/ioprio.h
+static constexpr int IOPrioWhoProcess = 1;
+static constexpr int IOPrioClassShift = 13;
+static constexpr int IOPrioClassBestEffort = 2;
+static constexpr int IOPrioClassIdle = 3;
+
+// 暂存目录，与缓存文件在同一文件系统中，保证重命名是原子的
+static QString stagingDir(const QString &localPrefix)
+{
+    return localPrefix + configPrefixPath() + "/.staging";
+}
+
+DSGConfigPersister::DSGConfigPersister(QObject *parent)
+    : QObject(parent)
+    , m_pool(new QThreadPool(this))
+    , m_state(std::make_shared<State>())
+{
+    // saved in order by one thread.
+    m_pool->setMaxThreadCount(1);
+    m_pool->setExpiryTimeout(-1);
+}
+
+DSGConfigPersister::~DSGConfigPersister()
+{
+    m_batchDepth = 0;
+    dispatchBatch();
+    // the writes are blocked, don't block the exit again.
+    if (m_timedOut && pendingCount() > 0) {
+        m_pool->setParent(nullptr);
+        return;
+    }
+    waitForDone();
+}
+
+/*!
+ \brief 全局缓存的快照，复制配置文件及其中的全局缓存
+ */
+DSGConfigPersister::Snapshot DSGConfigPersister::snapshot(const DConfigFile *file)
+{
+    Snapshot result;
+    result.file.reset(new DConfigFile(*file));
+    result.file->globalCache()->setCachePathPrefix(configPrefixPath() + "/global");
+    return result;
+}
+
+/*!
+ \brief 用户缓存的快照，复制所有配置项的值及序列号
+ \a file 缓存所属的配置文件
+ \a appid 修改配置项的应用
+ */
+DSGConfigPersister::Snapshot DSGConfigPersister::snapshot(DConfigFile *file, DConfigCache *cache, const QString &appid)
+{
+    Snapshot result;
+    const auto uid = cache->uid();
+    result.cache.reset(file->createUserCache(uid));
+    result.cache->setCachePathPrefix(configPrefixPath() + QString("/%1").arg(uid));
+    for (const auto &key : cache->keyList())
+        result.cache->setValue(key, cache->value(key), cache->serial(key), uid, appid);
+    return result;
+}
+
+/*!
+ \brief 提交需要保存的快照，同一批快照保存完成后在主线程中回调
+ \a callback 参数为是否全部保存成功
+ */
+void DSGConfigPersister::submit(std::vector<Snapshot> &&snapshots, const QString &localPrefix, const Callback &callback)
+{
+    if (m_batchDepth <= 0) {
+        dispatch(std::move(snapshots), localPrefix, callback ? QList<Callback>{callback} : QList<Callback>());
+        return;
+    }
+
+    // only the snapshots of the same prefix can be committed together.
+    if (!m_batch.empty() && m_batchPrefix != localPrefix)
+        dispatchBatch();
+
+    m_batchPrefix = localPrefix;
+    for (auto &item : snapshots)
+        m_batch.push_back(std::move(item));
+    if (callback)
+        m_batchCallbacks << callback;
+}
+
+/*!
+ \brief 开始合并提交，可嵌套，直到最外层的endBatch前提交的快照只同步一次磁盘
+ */
+void DSGConfigPersister::beginBatch()
+{
+    ++m_batchDepth;
+}
+
+void DSGConfigPersister::endBatch()
+{
+    if (m_batchDepth <= 0)
+        return;
+
+    if (--m_batchDepth == 0)
+        dispatchBatch();
+}
+
+void DSGConfigPersister::dispatchBatch()
+{
+    if (m_batch.empty() && m_batchCallbacks.isEmpty())
+        return;
+
+    std::vector<Snapshot> snapshots;
+    snapshots.swap(m_batch);
+    const auto callbacks = m_batchCallbacks;
+    m_batchCallbacks.clear();
+    dispatch(std::move(snapshots), m_batchPrefix, callbacks);
+}
+
+void DSGConfigPersister::dispatch(std::vector<Snapshot> &&snapshots, const QString &localPrefix, const QList<Callback> &callbacks)
+{
+    auto batch = std::make_shared<std::vector<Snapshot>>(std::move(snapshots));
+    auto state = m_state;
+    QPointer<DSGConfigPersister> self(this);
+    state->pendingCount.ref();
+    m_pool->start([state, self, batch, localPrefix, callbacks]() {
+        if (state->workerTid.loadAcquire() == 0)
+            state->workerTid.storeRelease(static_cast<int>(syscall(SYS_gettid)));
+        setWorkerPriority(state.get(), !state->urgent.loadAcquire());
+
+        QElapsedTimer timer;
+        timer.start();
+        const bool saved = commit(state.get(), *batch, localPrefix);
+        qCDebug(cfLog) << "Persisted the caches, count:" << batch->size() << ", elapsed:" << timer.elapsed();
+        batch->clear();
+
+        state->pendingCount.deref();
+        if (callbacks.isEmpty() || !QCoreApplication::instance())
+            return;
+        // the persister is checked in the main thread.
+        QMetaObject::invokeMethod(QCoreApplication::instance(), [self, callbacks, saved]() {
+            if (!self)
+                return;
+            for (const auto &callback : callbacks)
+                callback(saved);
+        }, Qt::QueuedConnection);
+    });
+}
+
+/*
+  \internal
+
+    \breaf 组提交快照，所有快照写入暂存目录，一次syncfs（不支持时逐个fdatasync）后重命名为目标文件，
+    写入中断时目标文件保持旧的内容，不会出现写了一半的缓存文件。
+*/
+bool DSGConfigPersister::commit(State *state, std::vector<Snapshot> &snapshots, const QString &localPrefix)
+{
+    if (snapshots.empty())
+        return true;
+
+    const auto &stagingRoot = stagingDir(localPrefix);
+    QString staging;
+    {
+        QMutexLocker locker(&state->mutex);
+        // the staged files of an interrupted commit are incomplete.
+        if (!state->cleanedStagingDirs.contains(stagingRoot)) {
+            state->cleanedStagingDirs.insert(stagingRoot);
+            QDir(stagingRoot).removeRecursively();
+        }
+        staging = QString("%1/%2").arg(stagingRoot).arg(++state->flushId);
+    }
+
+    bool saved = true;
+    for (auto &item : snapshots) {
+        if (item.cache) {
+            saved = item.cache->save(staging) && saved;
+        } else if (item.file) {
+            saved = item.file->save(staging) && saved;
+        }
+    }
+
+    QStringList files;
+    QDirIterator iterator(staging, QDir::Files | QDir::Hidden, QDirIterator::Subdirectories);
+    while (iterator.hasNext())
+        files << iterator.next();
+
+    quint64 bytes = 0;
+    quint64 syncs = 0;
+    for (const auto &file : files)
+        bytes += static_cast<quint64>(QFileInfo(file).size());
+
+    if (!files.isEmpty()) {
+        bool synced = false;
+        const int dirFd = ::open(QFile::encodeName(staging).constData(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+        if (dirFd >= 0) {
+            synced = ::syncfs(dirFd) == 0;
+            ::close(dirFd);
+        }
+        if (synced) {
+            ++syncs;
+        } else {
+            for (const auto &file : files) {
+                const int fd = ::open(QFile::encodeName(file).constData(), O_RDONLY | O_CLOEXEC);
+                if (fd < 0)
+                    continue;
+                if (::fdatasync(fd) == 0)
+                    ++syncs;
+                ::close(fd);
+            }
+        }
+    }
+
+    for (const auto &file : files) {
+        const auto &target = localPrefix + file.mid(staging.size());
+        if (!QDir().mkpath(QFileInfo(target).path())
+                || ::rename(QFile::encodeName(file).constData(), QFile::encodeName(target).constData()) != 0) {
+            qCWarning(cfLog) << "Can't replace the cache file:" << target << strerror(errno);
+            saved = false;
+        }
+    }
+    QDir(staging).removeRecursively();
+
+    {
+        QMutexLocker locker(&state->mutex);
+        auto &statistics = state->statistics;
+        ++statistics.flushes;
+        statistics.files += static_cast<quint64>(files.size());
+        statistics.bytes += bytes;
+        statistics.syncs += syncs;
+        statistics.lastBytes = bytes;
+        statistics.lastSyncs = syncs;
+    }
+    qCDebug(cfLog) << "Committed the caches, files:" << files.size() << ", bytes:" << bytes << ", syncs:" << syncs;
+    return saved;
+}
+
+/*!
+ \brief 等待已提交的快照保存完成，等待期间使用普通的IO优先级
+ \a msecs 超时时间，-1时一直等待
+ \return 超时时返回false
+ */
+bool DSGConfigPersister::waitForDone(const int msecs)
+{
+    m_state->urgent.storeRelease(1);
+    setWorkerPriority(m_state.get(), false);
+    const bool done = m_pool->waitForDone(msecs);
+    m_state->urgent.storeRelease(0);
+    m_timedOut = !done;
+    if (!done)
+        qCWarning(cfLog) << "Timeout to persist the caches, pending:" << pendingCount();
+    return done;
+}
+
+int DSGConfigPersister::pendingCount() const
+{
+    return m_state->pendingCount.loadAcquire();
+}
+
+/*!
+ \brief 组提交的统计，包括提交次数、写入的文件数、字节数及同步磁盘的次数
+ */
+DSGConfigPersister::Statistics DSGConfigPersister::statistics() const
+{
+    QMutexLocker locker(&m_state->mutex);
+    return m_state->statistics;
+}
+
+/*!
+ \brief 保留资源释放的缓存或配置文件，直到之前提交的保存完成后调用dropReleased，
+ 期间再次加载时以保留的内容为准，磁盘中的缓存文件可能还未更新
+ \a key 缓存的标识，同一缓存再次释放时替换之前保留的内容
+ \return 用于dropReleased的序号
+ */
+quint64 DSGConfigPersister::holdReleased(const QString &key, Snapshot &&content)
+{
+    auto &item = m_released[key];
+    item.content = std::move(content);
+    item.id = ++m_lastReleasedId;
+    return item.id;
+}
+
+/*!
+ \brief 保留的缓存或配置文件
+ \return 没有保留时返回空
+ */
+const DSGConfigPersister::Snapshot *DSGConfigPersister::released(const QString &key) const
+{
+    auto iter = m_released.find(key);
+    return iter != m_released.end() ? &iter->second.content : nullptr;
+}
+
+/*!
+ \brief 保存完成后删除保留的内容，之后再次释放的内容不受影响
+ */
+void DSGConfigPersister::dropReleased(const QString &key, const quint64 id)
+{
+    auto iter = m_released.find(key);
+    if (iter != m_released.end() && iter->second.id == id)
+        m_released.erase(iter);
+}
+
+/*
+  \internal
+
+    \breaf 设置持久化线程的IO优先级，不支持时忽略
+*/
+void DSGConfigPersister::setWorkerPriority(State *state, const bool idle)
+{
+    const int tid = state->workerTid.loadAcquire();
+    if (tid == 0 || state->workerIdle.fetchAndStoreOrdered(idle) == static_cast<int>(idle))
+        return;
+
+#ifdef SYS_ioprio_set
+    const int ioprio = idle ? (IOPrioClassIdle << IOPrioClassShift) : (IOPrioClassBestEffort << IOPrioClassShift | 4);
+    if (syscall(SYS_ioprio_set, IOPrioWhoProcess, tid, ioprio) < 0)
+        qCDebug(cfLog) << "Can't set the io priority of the persistence thread:" << strerror(errno);
+#endif
+}
@@ -0,0 +1,103 @@
+// SPDX-FileCopyrightText: 2026 Uniontech Software Technology Co.,Ltd.
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#pragma once
+
+#include <dtkcore_global.h>
+#include <QObject>
+#include <QAtomicInt>
+#include <QMutex>
+#include <QSet>
+#include <QPointer>
+#include <functional>
+#include <map>
+#include <memory>
+#include <vector>
+
+DCORE_BEGIN_NAMESPACE
+class DConfigFile;
+class DConfigCache;
+DCORE_END_NAMESPACE
+
+DCORE_USE_NAMESPACE
+
+class QThreadPool;
+/**
+ * @brief The DSGConfigPersister class
+ * 持久化线程，在单独的线程中以空闲的IO优先级按提交顺序保存缓存的快照，
+ * 快照与主线程中的缓存互不影响，保存完成后在主线程中回调。
+ * 每次提交的快照组提交：先写入暂存目录，一次syncfs后再重命名为目标文件。
+ */
+class DSGConfigPersister : public QObject
+{
+    Q_OBJECT
+public:
+    // 全局缓存的快照为复制的配置文件，用户缓存的快照为复制了值的用户缓存
+    struct Snapshot {
+        std::unique_ptr<DConfigFile> file;
+        std::unique_ptr<DConfigCache> cache;
+    };
+    using Callback = std::function<void(bool saved)>;
+    struct Statistics {
+        quint64 flushes = 0;
+        quint64 files = 0;
+        quint64 bytes = 0;
+        quint64 syncs = 0;
+        // 最后一次提交写入的字节数及同步次数
+        quint64 lastBytes = 0;
+        quint64 lastSyncs = 0;
+    };
+
+    explicit DSGConfigPersister(QObject *parent = nullptr);
+    virtual ~DSGConfigPersister() override;
+
+    static Snapshot snapshot(const DConfigFile *file);
+    static Snapshot snapshot(DConfigFile *file, DConfigCache *cache, const QString &appid);
+
+    void submit(std::vector<Snapshot> &&snapshots, const QString &localPrefix, const Callback &callback = Callback());
+    void beginBatch();
+    void endBatch();
+    bool waitForDone(const int msecs = -1);
+    int pendingCount() const;
+    Statistics statistics() const;
+
+    quint64 holdReleased(const QString &key, Snapshot &&content);
+    const Snapshot *released(const QString &key) const;
+    void dropReleased(const QString &key, const quint64 id);
+
+private:
+    // 与持久化线程共享，等待超时后线程池被遗留到进程退出时仍然有效
+    struct State {
+        QAtomicInt pendingCount;
+        // 等待完成时提高IO优先级，避免空闲优先级的写入被其它IO阻塞
+        QAtomicInt urgent;
+        QAtomicInt workerTid;
+        QAtomicInt workerIdle;
+        mutable QMutex mutex;
+        Statistics statistics;
+        quint64 flushId = 0;
+        QSet<QString> cleanedStagingDirs;
+    };
+    static void setWorkerPriority(State *state, const bool idle);
+    static bool commit(State *state, std::vector<Snapshot> &snapshots, const QString &localPrefix);
+    void dispatch(std::vector<Snapshot> &&snapshots, const QString &localPrefix, const QList<Callback> &callbacks);
+    void dispatchBatch();
+
+private:
+    QThreadPool *m_pool = nullptr;
+    std::shared_ptr<State> m_state;
+    bool m_timedOut = false;
+    // beginBatch及endBatch之间提交的快照合并为一次提交
+    int m_batchDepth = 0;
+    std::vector<Snapshot> m_batch;
+    QString m_batchPrefix;
+    QList<Callback> m_batchCallbacks;
+    // 资源释放的缓存，保存完成前再次加载时使用其中的内容
+    struct Released {
+        Snapshot content;
+        quint64 id = 0;
+    };
+    std::map<QString, Released> m_released;
+    quint64 m_lastReleasedId = 0;
+};
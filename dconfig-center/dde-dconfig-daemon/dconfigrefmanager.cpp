@@ -404,7 +404,7 @@ void RefManager::delayDeleteResource(const QList<ResourceRef *> &deleteResources
                 m_delayReleaseingConns.remove(resource);
                 auto resourceRef = resources.value(resource);
                 if (resourceRef && resourceRef->release()) {
-                    qCDebug(cfLog, "Resource[%s] removing.", qPrintable(resourceRef->resource));
+                    qCDebug(cfLog, "Resource[%s] removing.", qPrintable(resourceRef->resource.toString()));
                     doDeleteResource({resourceRef});
                 }
             });
@@ -414,12 +414,19 @@ void RefManager::delayDeleteResource(const QList<ResourceRef *> &deleteResources
     }
 }
 
+// 持久化等级为Lazy时的延迟倍数
+static constexpr int LazyDelayFactor = 10;
+// 一批保存期望的耗时，毫秒
+static constexpr double TargetBatchLatency = 100;
+
 ConfigSyncRequestCache::ConfigSyncRequestCache(QObject *parent)
     : QObject (parent)
     , m_syncTimer(new QBasicTimer())
     , m_delaySyncTime(3000)
     , m_batchCount(20)
+    , m_adaptiveBatchCount(m_batchCount)
 {
+    m_clock.start();
 }
 
 ConfigSyncRequestCache::~ConfigSyncRequestCache()
@@ -430,56 +437,106 @@ ConfigSyncRequestCache::~ConfigSyncRequestCache()
     m_syncTimer = nullptr;
 }
 
-void ConfigSyncRequestCache::pushRequest(const ConfigCacheKey &key)
+/*!
+ \brief 请求保存缓存，到期时间从第一次修改开始计算，已请求的缓存持久化等级更高时提前到期
+ */
+void ConfigSyncRequestCache::pushRequest(const ConfigCacheKey &key, const Durability durability)
 {
-    if (m_configCacheKeys.contains(key))
-        return;
+    auto iter = m_configCacheKeys.find(key);
+    if (iter != m_configCacheKeys.end()) {
+        const qint64 deadline = iter->firstChange + delayOf(durability);
+        if (iter->order.first <= deadline)
+            return;
 
-    qCDebug(cfLog()) << "Push syncConfigRequest key:" << key;
-    m_configCacheKeys.insert(key);
-    if (!m_syncTimer->isActive()) {
-        m_syncTimer->start(m_delaySyncTime, this);
+        m_requests.erase(iter->order);
+        iter->order.first = deadline;
+        m_requests.emplace(iter->order, key);
+    } else {
+        qCDebug(cfLog()) << "Push syncConfigRequest key:" << key << "durability:" << durability;
+        Request request;
+        request.firstChange = m_clock.elapsed();
+        request.order = RequestOrder{request.firstChange + delayOf(durability), ++m_sequence};
+        m_configCacheKeys.insert(key, request);
+        m_requests.emplace(request.order, key);
     }
+    schedule(0);
+}
+
+/*!
+ \brief 立即发出所有未保存的请求，如会话结束时
+ */
+void ConfigSyncRequestCache::flush()
+{
+    if (m_requests.empty())
+        return;
+
+    ConfigSyncBatchRequest request;
+    for (const auto &item : m_requests)
+        request.data << item.second;
+    m_requests.clear();
+    m_configCacheKeys.clear();
+    m_syncTimer->stop();
+    m_timerDeadline = -1;
+
+    qCDebug(cfLog, "Flush config cache, syncConfigRequest count:%d", request.data.count());
+    Q_EMIT syncConfigRequest(request);
 }
 
 void ConfigSyncRequestCache::clear()
 {
+    m_requests.clear();
     m_configCacheKeys.clear();
 
     if (m_syncTimer->isActive())
         m_syncTimer->stop();
+    m_timerDeadline = -1;
+}
+
+/*!
+ \brief 记录一批缓存保存完成的耗时，调整之后每批的数量及到期请求较多时的间隔
+ \a count 这一批缓存的数量
+ \a msecs 从请求到写入磁盘的耗时
+ */
+void ConfigSyncRequestCache::reportLatency(const int count, const qint64 msecs)
+{
+    if (count <= 0)
+        return;
+
+    const double keyLatency = static_cast<double>(msecs) / count;
+    m_keyLatency = m_keyLatency < 0 ? keyLatency : m_keyLatency * 0.7 + keyLatency * 0.3;
+    m_adaptiveBatchCount = qBound(1, static_cast<int>(TargetBatchLatency / qMax(m_keyLatency, 0.1)), m_batchCount);
+    m_batchLatency = qMin<qint64>(msecs, m_delaySyncTime);
+    qCDebug(cfLog, "Sync config cache latency:%lld ms for %d caches, batch count:%d", msecs, count, m_adaptiveBatchCount);
 }
 
-static const QString ConfigSyncRequestCacheGlobalPrefix("g-");
-static const QString ConfigSyncRequestCacheUserPrefix("u-");
 ConfigCacheKey ConfigSyncRequestCache::globalKey(const ResourceKey &key)
 {
-    return QString("%1%2").arg(ConfigSyncRequestCacheGlobalPrefix).arg(key);
+    return ConfigCacheKey(true, ConnKey(key, 0));
 }
 
 ConfigCacheKey ConfigSyncRequestCache::userKey(const ConnKey &key)
 {
-    return QString("%1%2").arg(ConfigSyncRequestCacheUserPrefix).arg(key);
+    return ConfigCacheKey(false, key);
 }
 
 bool ConfigSyncRequestCache::isGlobalKey(const ConfigCacheKey &key)
 {
-    return key.startsWith(ConfigSyncRequestCacheGlobalPrefix);
+    return key.global;
 }
 
 bool ConfigSyncRequestCache::isUserKey(const ConfigCacheKey &key)
 {
-    return key.startsWith(ConfigSyncRequestCacheUserPrefix);
+    return !key.global;
 }
 
 ResourceKey ConfigSyncRequestCache::getGlobalKey(const ConfigCacheKey &key)
 {
-    return key.mid(ConfigSyncRequestCacheGlobalPrefix.size());
+    return getResourceKey(key.key);
 }
 
 ConnKey ConfigSyncRequestCache::getUserKey(const ConfigCacheKey &key)
 {
-    return key.mid(ConfigSyncRequestCacheUserPrefix.size());
+    return key.key;
 }
 
 int ConfigSyncRequestCache::requestsCount() const
@@ -505,31 +562,84 @@ int ConfigSyncRequestCache::batchCount() const
 void ConfigSyncRequestCache::setBatchCount(const int count)
 {
     m_batchCount = count;
+    m_adaptiveBatchCount = count;
+    m_keyLatency = -1;
+}
+
+/*!
+ \brief 根据保存的耗时调整后每批的数量
+ */
+int ConfigSyncRequestCache::adaptiveBatchCount() const
+{
+    return m_adaptiveBatchCount;
 }
 
 void ConfigSyncRequestCache::timerEvent(QTimerEvent *event)
 {
     if (event->timerId() == m_syncTimer->timerId()) {
+        m_syncTimer->stop();
+        m_timerDeadline = -1;
         customRequest();
-
-        if (m_configCacheKeys.isEmpty())
-            m_syncTimer->stop();
+        // the due requests are left, wait for the writing of this batch.
+        schedule(m_batchLatency);
     }
 
     return QObject::timerEvent(event);
 }
 
+/*
+  \internal
+
+    \breaf 按到期时间发出一批已到期的请求
+*/
 void ConfigSyncRequestCache::customRequest()
 {
-    if (!m_configCacheKeys.isEmpty()) {
-        ConfigSyncBatchRequest request;
-        int i = 0;
-        for (auto iter = m_configCacheKeys.begin(); iter != m_configCacheKeys.end() && i < m_batchCount; i++) {
-            request.data << *iter;
-            iter = m_configCacheKeys.erase(iter);
-        }
-        qCDebug(cfLog, "Start sync config cache, syncConfigRequest count:%d, elapsed count:%d",
-                request.data.count(), m_configCacheKeys.count());
-        Q_EMIT syncConfigRequest(request);
+    const qint64 now = m_clock.elapsed();
+    ConfigSyncBatchRequest request;
+    for (auto iter = m_requests.begin(); iter != m_requests.end() && request.data.count() < m_adaptiveBatchCount;) {
+        if (iter->first.first > now)
+            break;
+
+        request.data << iter->second;
+        m_configCacheKeys.remove(iter->second);
+        iter = m_requests.erase(iter);
+    }
+    if (request.data.isEmpty())
+        return;
+
+    qCDebug(cfLog, "Start sync config cache, syncConfigRequest count:%d, elapsed count:%d",
+            request.data.count(), requestsCount());
+    Q_EMIT syncConfigRequest(request);
+}
+
+/*
+  \internal
+
+    \breaf 定时器在最早的请求到期时触发
+    \a minimumDelay 距现在最少的延迟
+*/
+void ConfigSyncRequestCache::schedule(const qint64 minimumDelay)
+{
+    if (m_requests.empty())
+        return;
+
+    const qint64 now = m_clock.elapsed();
+    const qint64 deadline = qMax(m_requests.begin()->first.first, now + minimumDelay);
+    if (m_syncTimer->isActive() && m_timerDeadline <= deadline)
+        return;
+
+    m_timerDeadline = deadline;
+    m_syncTimer->start(static_cast<int>(deadline - now), this);
+}
+
+qint64 ConfigSyncRequestCache::delayOf(const Durability durability) const
+{
+    switch (durability) {
+    case Immediate:
+        return 0;
+    case Lazy:
+        return static_cast<qint64>(m_delaySyncTime) * LazyDelayFactor;
+    default:
+        return m_delaySyncTime;
     }
 }
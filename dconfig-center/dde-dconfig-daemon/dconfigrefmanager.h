@@ -9,6 +9,9 @@
 #include <QHash>
 #include <QMap>
 #include <QTimer>
+#include <QElapsedTimer>
+
+#include <map>
 
 class ResourceRef;
 class ServiceRef;
@@ -74,15 +77,32 @@ struct ConfigSyncBatchRequest
     QList<ConfigCacheKey> data;
 };
 
+/**
+ * @brief The ConfigSyncRequestCache class
+ * 保存缓存的调度，按到期时间排序，到期时间为第一次修改的时间加上持久化等级对应的延迟，
+ * 每批的数量根据保存的耗时调整，到期的请求较多时按保存的耗时间隔分批。
+ */
 class ConfigSyncRequestCache : public QObject
 {
     Q_OBJECT
 public:
+    // 缓存的持久化等级，来自描述文件中的durability字段
+    enum Durability {
+        // 修改后立即保存
+        Immediate,
+        // 延迟delaySyncTime后保存
+        Normal,
+        // 延迟LazyDelayFactor倍的delaySyncTime后保存
+        Lazy
+    };
+
     explicit ConfigSyncRequestCache(QObject *parent = nullptr);
     virtual ~ConfigSyncRequestCache() override;
 
-    void pushRequest(const ConfigCacheKey& key);
+    void pushRequest(const ConfigCacheKey& key, const Durability durability = Normal);
+    void flush();
     void clear();
+    void reportLatency(const int count, const qint64 msecs);
 
     static ConfigCacheKey globalKey(const ResourceKey &key);
     static ConfigCacheKey userKey(const ConnKey &key);
@@ -96,6 +116,7 @@ public:
     void setDelaySyncTime(const int time);
     int batchCount() const;
     void setBatchCount(const int count);
+    int adaptiveBatchCount() const;
 
 Q_SIGNALS:
     void syncConfigRequest(const ConfigSyncBatchRequest &request);
@@ -104,12 +125,30 @@ protected:
     virtual void timerEvent(QTimerEvent *event) override;
 
 private:
+    // 到期时间及请求的序号，到期时间相同时先修改的在前
+    using RequestOrder = std::pair<qint64, quint64>;
+    struct Request {
+        qint64 firstChange = 0;
+        RequestOrder order;
+    };
+
     void customRequest();
+    void schedule(const qint64 minimumDelay);
+    qint64 delayOf(const Durability durability) const;
 
     QBasicTimer *m_syncTimer = nullptr;
-    QSet<ConfigCacheKey> m_configCacheKeys;
+    qint64 m_timerDeadline = -1;
+    QElapsedTimer m_clock;
+    std::map<RequestOrder, ConfigCacheKey> m_requests;
+    QHash<ConfigCacheKey, Request> m_configCacheKeys;
+    quint64 m_sequence = 0;
     int m_delaySyncTime;
     int m_batchCount;
+    // 根据保存的耗时调整，不超过m_batchCount
+    int m_adaptiveBatchCount;
+    // 每个缓存平均的保存耗时及上一批的保存耗时，毫秒
+    double m_keyLatency = -1;
+    qint64 m_batchLatency = 0;
 };
 
 Q_DECLARE_METATYPE(ConfigSyncBatchRequest)
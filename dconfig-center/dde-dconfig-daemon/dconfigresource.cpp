@@ -5,40 +5,162 @@
 #include "dconfigresource.h"
 #include "dconfigconn.h"
 #include "dconfigrefmanager.h"
+#include "dconfigconndispatcher.h"
 #include "dconfigfile.h"
+#include "dconfigmetadatabase.h"
+#include "dconfigpersister.h"
+#include <QBuffer>
+#include <QCryptographicHash>
+#include <QDataStream>
 #include <QDBusMessage>
 #include <QDBusConnection>
 #include <QDBusConnectionInterface>
+#include <QDir>
 #include <QFile>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QMutex>
+#include <QPointer>
+#include <QTimer>
+#include <QUrl>
 #include <QDebug>
 
-#include "manager_adaptor.h"
+#include <algorithm>
+#include <map>
+
+#include <pwd.h>
 
 Q_DECLARE_LOGGING_CATEGORY(cfLog);
 DCORE_USE_NAMESPACE
 
 
+/*
+  \internal
+
+    \breaf 资源的日志文件，未设置STATE_DIRECTORY时不使用日志，修改后保存整个缓存文件
+*/
+static QString journalDirectory()
+{
+    const char *stateDirectory("STATE_DIRECTORY");
+    if (qEnvironmentVariableIsEmpty(stateDirectory))
+        return QString();
+
+    return QString("%1/journal").arg(qEnvironmentVariable(stateDirectory));
+}
+
+static QString journalPath(const GenericResourceKey &key)
+{
+    const auto &directory = journalDirectory();
+    if (directory.isEmpty())
+        return QString();
+
+    return QString("%1/%2.journal").arg(directory, QString::fromLatin1(QUrl::toPercentEncoding(key.toString())));
+}
+
+/*
+  \internal
+
+    \breaf 保存完成后删除持久化线程保留的缓存，保存失败时继续保留，再次加载时重新保存
+*/
+static DSGConfigPersister::Callback dropReleasedCallback(DSGConfigPersister *persister, const QList<QPair<QString, quint64>> &released)
+{
+    QPointer<DSGConfigPersister> guard(persister);
+    return [guard, released](bool saved) {
+        if (!guard || !saved)
+            return;
+        for (const auto &item : released)
+            guard->dropReleased(item.first, item.second);
+    };
+}
+
+/*
+  \internal
+
+    \breaf 描述文件中的持久化等级，没有durability字段时为Normal
+*/
+static ConfigSyncRequestCache::Durability metaDurability(const QByteArray &content)
+{
+    // don't parse the meta without the field.
+    if (!content.contains("\"durability\""))
+        return ConfigSyncRequestCache::Normal;
+
+    const auto &durability = QJsonDocument::fromJson(content).object().value("durability").toString();
+    if (durability == "immediate")
+        return ConfigSyncRequestCache::Immediate;
+    if (durability == "lazy")
+        return ConfigSyncRequestCache::Lazy;
+    return ConfigSyncRequestCache::Normal;
+}
+
 DSGConfigResource::DSGConfigResource(const QString &name, const QString &subpath, const QString &localPrefix, QObject *parent)
     : QObject (parent),
       m_key(getGenericResourceKey(name, subpath)),
       m_fileName(name),
       m_subpath(subpath),
-      m_localPrefix(localPrefix)
+      m_localPrefix(localPrefix),
+      m_journalTimer(new QTimer(this)),
+      m_journalCompactionSize(64 * 1024)
 {
+    ConfigKeyAtoms::ref(m_key.name);
+    ConfigKeyAtoms::ref(m_key.subpath);
+    m_journal.setPath(journalPath(m_key));
+    m_journalTimer->setSingleShot(true);
+    m_journalTimer->setInterval(60 * 1000);
+    connect(m_journalTimer, &QTimer::timeout, this, [this]() {
+        compactJournal();
+    });
 }
 
 DSGConfigResource::~DSGConfigResource()
 {
     qDeleteAll(m_conns);
     m_conns.clear();
+    m_connsByResource.clear();
+    m_connsByUid.clear();
+    m_specificAppConns.clear();
+
+    if (m_persister) {
+        // the resource may be created again before the caches are saved.
+        QList<QPair<QString, quint64>> released;
+        for (auto iter = m_files.cbegin(); iter != m_files.cend(); ++iter) {
+            const auto &key = ConfigSyncRequestCache::globalKey(iter.key()).toString();
+            DSGConfigPersister::Snapshot content;
+            content.file.reset(iter.value());
+            released << qMakePair(key, m_persister->holdReleased(key, std::move(content)));
+        }
+        for (auto iter = m_caches.cbegin(); iter != m_caches.cend(); ++iter) {
+            const auto &key = ConfigSyncRequestCache::userKey(iter.key()).toString();
+            DSGConfigPersister::Snapshot content;
+            content.cache.reset(iter.value());
+            released << qMakePair(key, m_persister->holdReleased(key, std::move(content)));
+        }
+        const auto dropReleased = dropReleasedCallback(m_persister, released);
+        save([dropReleased, followUps = m_journalFollowUpCallbacks](bool saved) {
+            dropReleased(saved);
+            // the journal is saved by the last save instead of the follow-up compaction.
+            for (const auto &callback : followUps)
+                callback(saved);
+        });
+    } else {
+        save();
+        qDeleteAll(m_files);
+        qDeleteAll(m_caches);
+    }
+    m_journalFollowUpCallbacks.clear();
 
-    save();
-
-    qDeleteAll(m_files);
+    for (auto iter = m_files.cbegin(); iter != m_files.cend(); ++iter)
+        ConfigKeyAtoms::deref(iter.key().appid);
     m_files.clear();
+    m_keyIndexes.clear();
+    m_durabilities.clear();
 
-    qDeleteAll(m_caches);
     m_caches.clear();
+    m_cachesByResource.clear();
+
+    ConfigKeyAtoms::deref(m_key.name);
+    ConfigKeyAtoms::deref(m_key.subpath);
+    // release the names of this resource and of the failed requests.
+    ConfigKeyAtoms::sweep();
 }
 
 bool DSGConfigResource::load(const QString &appid)
@@ -51,6 +173,31 @@ void DSGConfigResource::setSyncRequestCache(ConfigSyncRequestCache *cache)
     m_syncRequestCache = cache;
 }
 
+void DSGConfigResource::setConnDispatcher(DSGConfigConnDispatcher *dispatcher)
+{
+    m_connDispatcher = dispatcher;
+}
+
+void DSGConfigResource::setCredentialCache(ServiceCredentialCache *cache)
+{
+    m_credentialCache = cache;
+}
+
+void DSGConfigResource::setMetaDatabase(const DSGConfigMetaDatabase *database)
+{
+    m_metaDatabase = database;
+}
+
+void DSGConfigResource::setPersister(DSGConfigPersister *persister)
+{
+    m_persister = persister;
+}
+
+ServiceCredentialCache *DSGConfigResource::credentialCache() const
+{
+    return m_credentialCache;
+}
+
 DSGConfigConn *DSGConfigResource::getConn(const QString &appid, const uint uid) const
 {
     const ConnKey &connKey = getConnKey(appid, uid);
@@ -71,7 +218,7 @@ DSGConfigConn *DSGConfigResource::createConn(const QString &appid, const uint ui
     if (!cache) {
         cache = createCache(appid, uid);
         if (!cache) {
-            qWarning() << QString("Create cache error for [%1]'s [%2].").arg(uid).arg(connKey);
+            qWarning() << QString("Create cache error for [%1]'s [%2].").arg(uid).arg(connKey.toString());
             return nullptr;
         }
 
@@ -79,23 +226,19 @@ DSGConfigConn *DSGConfigResource::createConn(const QString &appid, const uint ui
     }
 
     std::unique_ptr<DSGConfigConn> connPointer(new DSGConfigConn(connKey, this));
-    if (qgetenv("DSG_CONFIG_CONNECTION_DISABLE_DBUS").isEmpty()) {
-        (void) new DSGConfigManagerAdaptor(connPointer.get());
-        QDBusConnection bus = QDBusConnection::systemBus();
-        const auto path = connPointer->path();
-        bus.unregisterObject(path);
-        if (!bus.registerObject(path, connPointer.get())) {
-            qWarning() << QString("Can't register the object %1.").arg(path);
+    if (m_connDispatcher && qgetenv("DSG_CONFIG_CONNECTION_DISABLE_DBUS").isEmpty()) {
+        if (!m_connDispatcher->addConn(connPointer.get())) {
+            qWarning() << QString("Can't register the object %1.").arg(connPointer->path());
             return nullptr;
         }
     }
 
     // Add cache to `m_caches` only initialized successful, otherwise it should be deleted.
     if (cacheHolder)
-        m_caches.insert(connKey, cacheHolder.release());
+        insertCache(connKey, cacheHolder.release());
 
     auto conn = connPointer.release();
-    m_conns.insert(connKey, conn);
+    insertConn(connKey, conn);
     conn->setResource(this);
 
     QObject::connect(conn, &DSGConfigConn::releaseChanged, this, &DSGConfigResource::onReleaseChanged);
@@ -120,53 +263,111 @@ int DSGConfigResource::connSize() const
  */
 bool DSGConfigResource::reparse(const QString &appid)
 {
-    const auto &resouceKey = getResourceKey(appid, m_key);
-    auto file = getFile(resouceKey);
-    if (!file)
+    auto config = prepareReparse(appid);
+    if (!config)
         return true;
 
-    std::unique_ptr<DConfigFile> config(new DConfigFile(*file));
-    config->globalCache()->setCachePathPrefix(configPrefixPath() + "/global");
-    auto newMeta = config->meta();
-    if (!newMeta->load()) {
-        qWarning() << QString("Reparse resource error for [%1].").arg(m_key);
+    if (!config->meta()->load()) {
+        qWarning() << QString("Reparse resource error for [%1].").arg(m_key.toString());
         return false;
     }
+    return applyReparse(appid, std::move(config));
+}
 
-    QMap<DConfigCache*, QList<QString>> cacheChangedValues;
-    DConfigMeta *oldMeta = file->meta();
-    QList<DConfigCache*> caches;
+/*!
+ \brief 复制待解析的配置文件对象，可在其它线程中加载描述文件，
+ 之后通过applyReparse替换原有的配置文件
+ \return 资源未加载此应用时返回空
+ */
+std::unique_ptr<DConfigFile> DSGConfigResource::prepareReparse(const QString &appid)
+{
+    // the generic configuration may be installed or removed.
+    m_canFallbackToGeneric.reset();
 
-    for (auto  item : cachesOfTheResource(resouceKey))
-        caches.push_back(item);
+    auto file = getFile(getResourceKey(appid, m_key));
+    if (!file)
+        return nullptr;
 
-    caches.push_back(file->globalCache());
+    std::unique_ptr<DConfigFile> config(new DConfigFile(*file));
+    config->globalCache()->setCachePathPrefix(configPrefixPath() + "/global");
+    return config;
+}
+
+/*!
+ \brief 使用已加载描述文件的配置文件对象替换原有的配置文件，
+ 替换前合并解析期间修改的全局缓存，更新缓存后发送值变化的信号
+ \a config prepareReparse创建且已加载描述文件的对象
+ */
+bool DSGConfigResource::applyReparse(const QString &appid, std::unique_ptr<DConfigFile> config)
+{
+    m_canFallbackToGeneric.reset();
 
-    // cache and valuechanged.
-    for (auto cache : caches) {
-        QList<QString> changedValues;
-        for (auto key : oldMeta->keyList()) {
-            if (oldMeta->flags(key).testFlag(DConfigFile::Global) ^ cache->isGlobal())
-                continue;
+    const auto &resouceKey = getResourceKey(appid, m_key);
+    auto file = getFile(resouceKey);
+    if (!file || !config)
+        return true;
 
-            if (file->value(key, cache) == config->value(key, cache))
-                continue;
+    DConfigCache *globalCache = config->globalCache();
+    mergeCache(globalCache, file->globalCache(), appid);
 
-            changedValues.push_back(key);
-        }
-        if (!changedValues.isEmpty()) {
-            cacheChangedValues[cache] = changedValues;
+    auto newMeta = config->meta();
+
+    QMap<DConfigCache*, QList<QString>> cacheChangedValues;
+    DConfigMeta *oldMeta = file->meta();
+    // only the keys changed in meta may change the values.
+    const auto &diff = diffMeta(oldMeta, newMeta);
+    if (!diff.isEmpty()) {
+        QList<QPair<ConfigCacheKey, DConfigCache*>> caches;
+        const auto &userCaches = m_cachesByResource.value(resouceKey);
+        for (auto iter = userCaches.cbegin(); iter != userCaches.cend(); ++iter)
+            caches.push_back(qMakePair(ConfigSyncRequestCache::userKey(iter.key()), iter.value()));
+
+        caches.push_back(qMakePair(ConfigSyncRequestCache::globalKey(resouceKey), globalCache));
+
+        // cache and valuechanged.
+        for (const auto &item : caches) {
+            auto cache = item.second;
+            QList<QString> changedValues;
+            for (const auto &key : diff.changedKeys) {
+                if (oldMeta->flags(key).testFlag(DConfigFile::Global) ^ cache->isGlobal())
+                    continue;
+
+                if (file->value(key, cache) == config->value(key, cache))
+                    continue;
+
+                changedValues.push_back(key);
+            }
+            if (!changedValues.isEmpty()) {
+                cacheChangedValues[cache] = changedValues;
+            }
+            if (repareCache(cache, diff, oldMeta, newMeta)) {
+                markDirty(item.first);
+                if (Q_LIKELY(m_syncRequestCache))
+                    m_syncRequestCache->pushRequest(item.first, durability(resouceKey));
+            }
         }
-        repareCache(cache, oldMeta, newMeta);
     }
 
     // config refresh.
     std::unique_ptr<DConfigFile> oldConfig(file);
-    m_files[resouceKey] = config.release();
+    m_durabilities[resouceKey] = loadDurability(appid, config.get());
+    m_files[resouceKey] = config.get();
+    updateKeyIndex(resouceKey, config.release());
+
+    // the journal can't replay the values removed by the meta, compact it with the new file.
+    if (!diff.isEmpty())
+        compactJournal();
+
+    // generic configuration is the fallback of all application's configuration.
+    const auto &affectedConns = appid == VirtualInterAppId ? m_conns.values() : connsOfTheResource(resouceKey);
+    for (auto conn : affectedConns)
+        conn->invalidateValues();
 
     // emit valuechanged.
     for (auto iter = cacheChangedValues.begin(); iter != cacheChangedValues.end(); ++iter) {
         if (iter.key()->isGlobal()) {
+            if (Q_LIKELY(m_syncRequestCache))
+                m_syncRequestCache->pushRequest(ConfigSyncRequestCache::globalKey(resouceKey), durability(resouceKey));
             for (const QString &key : iter.value()) {
                 doGlobalValueChanged(key, resouceKey);
             }
@@ -193,30 +394,415 @@ void DSGConfigResource::onReleaseChanged(const ConnServiceName &service)
     }
 }
 
+/*!
+ \brief 保存整个缓存文件，缓存的修改在日志中时合并日志，同时保存日志中其它修改过的缓存
+ */
 void DSGConfigResource::doSyncConfigCache(const ConfigCacheKey &key)
 {
-    if (ConfigSyncRequestCache::isUserKey(key)) {
-        const auto connKey = ConfigSyncRequestCache::getUserKey(key);
-        if (auto cache = getCache(connKey)) {
-            qCDebug(cfLog()) << "Sync conn cache for user cache, key:" << key;
-            cache->save(m_localPrefix);
+    qCDebug(cfLog()) << "Sync conn cache for" << (ConfigSyncRequestCache::isUserKey(key) ? "user cache," : "global cache,")
+                     << "key:" << key;
+    // the journal is removed only after all the caches in it are saved.
+    if (m_journaledCaches.contains(key)) {
+        compactJournal();
+        return;
+    }
+    persist({key});
+}
+
+/*
+  \internal
+
+    \breaf 保存文件及缓存，设置了持久化线程时在其中保存快照，否则直接保存，
+    全部保存完成后在主线程中回调，未加载的、未修改的及内容与上次保存相同的缓存被忽略
+*/
+void DSGConfigResource::persist(const QList<ConfigCacheKey> &keys, const DSGConfigPersister::Callback &callback)
+{
+    std::vector<DSGConfigPersister::Snapshot> snapshots;
+    QList<QPair<ConfigCacheKey, QByteArray>> contents;
+    bool saved = true;
+    for (const auto &key : keys) {
+        const auto &resourceKey = getResourceKey(key.key);
+        auto file = getFile(resourceKey);
+        if (!file)
+            continue;
+
+        const bool isGlobal = ConfigSyncRequestCache::isGlobalKey(key);
+        auto cache = isGlobal ? file->globalCache() : getCache(ConfigSyncRequestCache::getUserKey(key));
+        if (!cache)
+            continue;
+
+        if (!m_dirtyCaches.remove(key)) {
+            ++m_skippedWrites;
+            continue;
+        }
+        // the value may be changed back after the last save.
+        const auto &hash = cacheContentHash(cache);
+        if (m_persistedHashes.value(key) == hash) {
+            ++m_skippedWrites;
+            continue;
+        }
+        contents << qMakePair(key, hash);
+
+        if (isGlobal) {
+            if (!m_persister) {
+                saved = file->save(m_localPrefix) && saved;
+            } else {
+                snapshots.push_back(DSGConfigPersister::snapshot(file));
+            }
+        } else {
+            if (!m_persister) {
+                saved = cache->save(m_localPrefix) && saved;
+            } else {
+                snapshots.push_back(DSGConfigPersister::snapshot(file, cache, innerAppidToOuter(ConfigKeyAtoms::value(resourceKey.appid))));
+            }
+        }
+    }
+
+    if (!m_persister) {
+        onPersisted(contents, saved);
+        if (callback)
+            callback(saved);
+        return;
+    }
+    QPointer<DSGConfigResource> self(this);
+    m_persister->submit(std::move(snapshots), m_localPrefix, [self, contents, callback](bool saved) {
+        if (self)
+            self->onPersisted(contents, saved);
+        if (callback)
+            callback(saved);
+    });
+}
+
+/*
+  \internal
+
+    \breaf 记录保存成功的缓存内容的哈希，保存失败时重新标记为已修改，已释放的缓存被忽略
+*/
+void DSGConfigResource::onPersisted(const QList<QPair<ConfigCacheKey, QByteArray>> &contents, const bool saved)
+{
+    for (const auto &item : contents) {
+        const auto &key = item.first;
+        const auto &resourceKey = getResourceKey(key.key);
+        const bool exists = ConfigSyncRequestCache::isGlobalKey(key) ? getFile(resourceKey) != nullptr
+                                                                      : getCache(ConfigSyncRequestCache::getUserKey(key)) != nullptr;
+        if (!exists)
+            continue;
+
+        if (saved) {
+            m_persistedHashes[key] = item.second;
+        } else {
+            m_persistedHashes.remove(key);
+            m_dirtyCaches.insert(key);
         }
-    } else if (ConfigSyncRequestCache::isGlobalKey(key)) {
-        const auto resourceKey = ConfigSyncRequestCache::getGlobalKey(key);
-        if (auto file = getFile(resourceKey)) {
-            qCDebug(cfLog()) << "Sync conn cache for global cache, key:" << key;
-            file->save(m_localPrefix);
+    }
+}
+
+/*
+  \internal
+
+    \breaf 保存并释放缓存或配置文件，设置了持久化线程时由其保留到之前提交的保存完成，
+    期间再次加载时使用保留的内容，不读取磁盘中还未更新的缓存文件
+*/
+void DSGConfigResource::persistReleased(const ConfigCacheKey &key, DSGConfigPersister::Snapshot &&content)
+{
+    if (!m_persister) {
+        persist({key});
+        return;
+    }
+    const auto &name = key.toString();
+    const auto id = m_persister->holdReleased(name, std::move(content));
+    persist({key}, dropReleasedCallback(m_persister, {qMakePair(name, id)}));
+}
+
+/*
+  \internal
+
+    \breaf 缓存中的值或序列号发生变化，下次保存时写入
+*/
+void DSGConfigResource::markDirty(const ConfigCacheKey &key)
+{
+    m_dirtyCaches.insert(key);
+}
+
+/*
+  \internal
+
+    \breaf 缓存被释放，再次加载时以缓存文件为准
+*/
+void DSGConfigResource::forgetCache(const ConfigCacheKey &key)
+{
+    m_dirtyCaches.remove(key);
+    m_persistedHashes.remove(key);
+}
+
+/*
+  \internal
+
+    \breaf 缓存内容的哈希，包括所有配置项的值及序列号
+*/
+QByteArray DSGConfigResource::cacheContentHash(DConfigCache *cache)
+{
+    auto keys = cache->keyList();
+    std::sort(keys.begin(), keys.end());
+
+    QByteArray content;
+    QDataStream stream(&content, QIODevice::WriteOnly);
+    stream.setVersion(QDataStream::Qt_5_11);
+    for (const auto &key : keys)
+        stream << key << cache->value(key) << static_cast<qint32>(cache->serial(key));
+    return QCryptographicHash::hash(content, QCryptographicHash::Sha1);
+}
+
+/*!
+ \brief 缓存是否有未保存的修改
+ */
+bool DSGConfigResource::isDirty(const ConfigCacheKey &key) const
+{
+    return m_dirtyCaches.contains(key);
+}
+
+/*!
+ \brief 因未修改或内容与上次保存相同而跳过的写入次数
+ */
+quint64 DSGConfigResource::skippedWrites() const
+{
+    return m_skippedWrites;
+}
+
+const DSGConfigJournal &DSGConfigResource::journal() const
+{
+    return m_journal;
+}
+
+/*!
+ \brief 设置合并日志的条件
+ \a size 日志超出此大小时立即合并
+ \a ms 第一条记录写入后经过此时间合并
+ */
+void DSGConfigResource::setJournalCompactionThreshold(const qint64 size, const int ms)
+{
+    m_journalCompactionSize = size;
+    m_journalTimer->setInterval(ms);
+}
+
+/*!
+ \brief 将日志合并到缓存文件，轮转日志后保存日志中修改过的缓存，保存完成后删除日志段，
+ 保存失败时保留日志段，之后重试，同时只进行一次合并，
+ 合并期间再次请求时，在当前的合并完成后再合并之后追加的记录
+ \a callback 调用前日志中的修改全部保存后回调
+ */
+void DSGConfigResource::compactJournal(const DSGConfigPersister::Callback &callback)
+{
+    if (m_journalCompacting) {
+        m_journalFollowUp = true;
+        if (callback)
+            m_journalFollowUpCallbacks << callback;
+        return;
+    }
+    m_journalTimer->stop();
+    if (m_journaledCaches.isEmpty()) {
+        if (callback)
+            callback(true);
+        return;
+    }
+
+    const auto keys = m_journaledCaches.values();
+    m_journaledCaches.clear();
+    const auto segment = m_journal.rotate();
+    m_journalCompacting = true;
+    QPointer<DSGConfigResource> self(this);
+    persist(keys, [self, keys, segment, path = m_journal.path(), callback](bool saved) {
+        if (saved)
+            DSGConfigJournal::removeSegments(path, segment);
+
+        if (self) {
+            self->m_journalCompacting = false;
+            if (!saved) {
+                qCWarning(cfLog) << "Can't compact the journal of the resource:" << self->m_key.toString();
+                for (const auto &key : keys)
+                    self->m_journaledCaches.insert(key);
+            }
+            if (self->m_journalFollowUp) {
+                self->m_journalFollowUp = false;
+                const auto callbacks = self->m_journalFollowUpCallbacks;
+                self->m_journalFollowUpCallbacks.clear();
+                self->compactJournal([callbacks](bool saved) {
+                    for (const auto &item : callbacks)
+                        item(saved);
+                });
+            } else if (!self->m_journaledCaches.isEmpty()) {
+                if (self->m_journal.size() >= self->m_journalCompactionSize) {
+                    self->compactJournal();
+                } else if (!self->m_journalTimer->isActive()) {
+                    self->m_journalTimer->start();
+                }
+            }
+        }
+        if (callback)
+            callback(saved);
+    });
+}
+
+/*!
+ \brief 删除日志中此用户的用户缓存记录，用户被删除后重放日志时不再创建其缓存文件
+ */
+void DSGConfigResource::removeUserJournal(const uint uid)
+{
+    m_journal.removeUserRecords(uid);
+    for (auto iter = m_journaledCaches.begin(); iter != m_journaledCaches.end();) {
+        if (!iter->global && iter->key.uid == uid) {
+            iter = m_journaledCaches.erase(iter);
+        } else {
+            ++iter;
         }
-    } else {
-        qCWarning(cfLog()) << "It's not exist config cache key" << key;
     }
 }
 
+/*!
+ \brief 删除未加载资源的日志中此用户的用户缓存记录
+ \a excludes 已加载资源的日志，由removeUserJournal处理
+ */
+void DSGConfigResource::removeUserJournals(const uint uid, const QSet<QString> &excludes)
+{
+    const auto &directory = journalDirectory();
+    if (directory.isEmpty())
+        return;
+
+    const QDir journalDir(directory);
+    const auto &names = journalDir.entryList(QStringList() << "*.journal", QDir::Files);
+    for (const auto &name : names) {
+        const auto &path = journalDir.filePath(name);
+        if (!excludes.contains(path))
+            DSGConfigJournal::removeUserRecords(path, uid);
+    }
+}
+
+/*
+  \internal
+
+    \breaf 记录缓存中配置项的修改，追加到日志并按持久化等级请求保存，到期时合并日志，
+    持久化等级为Immediate的缓存不追加到日志，立即保存
+*/
+void DSGConfigResource::requestSync(const ConfigCacheKey &cacheKey, const QString &key, const uint uid)
+{
+    markDirty(cacheKey);
+    const auto level = durability(getResourceKey(cacheKey.key));
+    if (level != ConfigSyncRequestCache::Immediate)
+        appendJournal(cacheKey, key, uid);
+
+    if (Q_LIKELY(m_syncRequestCache))
+        m_syncRequestCache->pushRequest(cacheKey, level);
+}
+
+/*
+  \internal
+
+    \breaf 将缓存中配置项当前的值及序列号追加到日志，重放时以最后一条记录为准
+*/
+bool DSGConfigResource::appendJournal(const ConfigCacheKey &cacheKey, const QString &key, const uint uid)
+{
+    if (m_journal.path().isEmpty())
+        return false;
+
+    const auto &resourceKey = getResourceKey(cacheKey.key);
+    DConfigCache *cache = nullptr;
+    if (ConfigSyncRequestCache::isUserKey(cacheKey)) {
+        cache = getCache(ConfigSyncRequestCache::getUserKey(cacheKey));
+    } else if (auto file = getFile(resourceKey)) {
+        cache = file->globalCache();
+    }
+    if (!cache)
+        return false;
+
+    DSGConfigJournal::Record record;
+    record.global = cacheKey.global;
+    record.appid = ConfigKeyAtoms::value(resourceKey.appid);
+    record.uid = uid;
+    record.key = key;
+    record.serial = cache->serial(key);
+    record.value = cache->value(key);
+    if (!m_journal.append(record))
+        return false;
+
+    m_journaledCaches.insert(cacheKey);
+    if (m_journal.size() >= m_journalCompactionSize) {
+        // compact after the pending changes in the event loop.
+        QMetaObject::invokeMethod(this, [this]() {
+            compactJournal();
+        }, Qt::QueuedConnection);
+    } else if (!m_journalTimer->isActive()) {
+        m_journalTimer->start();
+    }
+    return true;
+}
+
+/*
+  \internal
+
+    \breaf 服务异常退出时日志未合并，首次加载资源前将日志中的修改写入缓存文件
+*/
+void DSGConfigResource::recoverJournal()
+{
+    m_journalRecovered = true;
+    if (m_journal.isEmpty())
+        return;
+
+    const auto &records = m_journal.read();
+    std::map<QString, std::unique_ptr<DConfigFile>> files;
+    std::map<std::pair<QString, uint>, std::unique_ptr<DConfigCache>> caches;
+    bool saved = true;
+    for (const auto &record : records) {
+        // the user may be removed before the journal is compacted.
+        if (!record.global && !getpwuid(record.uid)) {
+            qCInfo(cfLog) << "Skip the journal record of the removed user:" << record.uid << ", key:" << record.key;
+            continue;
+        }
+        auto &file = files[record.appid];
+        if (!file)
+            file = loadFile(record.appid);
+        if (!file) {
+            saved = false;
+            continue;
+        }
+
+        DConfigCache *cache = file->globalCache();
+        if (!record.global) {
+            auto &userCache = caches[std::make_pair(record.appid, record.uid)];
+            if (!userCache) {
+                userCache.reset(file->createUserCache(record.uid));
+                userCache->setCachePathPrefix(configPrefixPath() + QString("/%1").arg(record.uid));
+                userCache->load(m_localPrefix);
+            }
+            cache = userCache.get();
+        }
+
+        if (record.value.isValid()) {
+            cache->setValue(record.key, record.value, record.serial, record.uid, innerAppidToOuter(record.appid));
+        } else {
+            cache->remove(record.key);
+        }
+    }
+    for (const auto &item : caches)
+        saved = item.second->save(m_localPrefix) && saved;
+    for (const auto &item : files) {
+        if (item.second)
+            saved = item.second->save(m_localPrefix) && saved;
+    }
+
+    qCInfo(cfLog) << "Recovered the journal of the resource:" << m_key.toString() << ", records:" << records.size();
+    if (saved)
+        m_journal.clear();
+}
+
 bool DSGConfigResource::fallbackToGenericConfig() const
 {
+    if (m_canFallbackToGeneric)
+        return *m_canFallbackToGeneric;
+
     // 判断是否需要fallback到公共配置
     DConfigFile file(NoAppId, m_fileName, m_subpath);
     const bool canFallbackToGeneric = !file.meta()->metaPath(m_localPrefix).isEmpty();
+    m_canFallbackToGeneric = canFallbackToGeneric;
     return canFallbackToGeneric;
 }
 
@@ -232,19 +818,156 @@ DConfigFile *DSGConfigResource::noAppidFile() const
 
 DConfigFile *DSGConfigResource::getOrCreateFile(const QString &appid)
 {
+    if (Q_UNLIKELY(!m_journalRecovered))
+        recoverJournal();
+
     const auto resourceKey = getResourceKey(appid, m_key);
     if (auto file = m_files.value(resourceKey))
         return file;
 
-    std::unique_ptr<DConfigFile> file(new DConfigFile(innerAppidToOuter(appid), m_fileName, m_subpath));
-    file->globalCache()->setCachePathPrefix(configPrefixPath() + "/global");
-    if (!file->load(m_localPrefix))
+    auto file = loadFile(appid);
+    if (!file)
         return nullptr;
 
+    // the released global cache may not be saved yet.
+    const auto &cacheKey = ConfigSyncRequestCache::globalKey(resourceKey);
+    if (auto released = m_persister ? m_persister->released(cacheKey.toString()) : nullptr) {
+        if (released->file && mergeCache(file->globalCache(), released->file->globalCache(), appid))
+            markDirty(cacheKey);
+    }
+
     m_files.insert(resourceKey, file.get());
+    ConfigKeyAtoms::ref(resourceKey.appid);
+    m_durabilities.insert(resourceKey, loadDurability(appid, file.get()));
+    updateKeyIndex(resourceKey, file.get());
     return file.release();
 }
 
+/*
+  \internal
+
+    \breaf 从描述文件数据库或描述文件中读取持久化等级
+*/
+ConfigSyncRequestCache::Durability DSGConfigResource::loadDurability(const QString &appid, DConfigFile *file) const
+{
+    if (m_metaDatabase && m_metaDatabase->isOpen()) {
+        const auto &data = m_metaDatabase->meta(innerAppidToOuter(appid), m_fileName, m_subpath);
+        if (data.isValid())
+            return metaDurability(data.meta);
+    }
+
+    QFile metaFile(file->meta()->metaPath(m_localPrefix));
+    if (!metaFile.open(QIODevice::ReadOnly))
+        return ConfigSyncRequestCache::Normal;
+    return metaDurability(metaFile.readAll());
+}
+
+/*!
+ \brief 配置的持久化等级，未加载的配置为Normal
+ */
+ConfigSyncRequestCache::Durability DSGConfigResource::durability(const ResourceKey &key) const
+{
+    return m_durabilities.value(key, ConfigSyncRequestCache::Normal);
+}
+
+/*
+  \internal
+
+    \breaf 加载描述文件及全局缓存，描述文件数据库中存在此配置时读取其中的描述文件及override差异，
+    不再查找描述文件及override目录
+*/
+std::unique_ptr<DConfigFile> DSGConfigResource::loadFile(const QString &appid) const
+{
+    const auto &outerAppid = innerAppidToOuter(appid);
+    if (m_metaDatabase && m_metaDatabase->isOpen()) {
+        const auto &data = m_metaDatabase->meta(outerAppid, m_fileName, m_subpath);
+        if (data.isValid()) {
+            std::unique_ptr<DConfigFile> file(new DConfigFile(outerAppid, m_fileName, m_subpath));
+            file->globalCache()->setCachePathPrefix(configPrefixPath() + "/global");
+            QBuffer buffer;
+            buffer.setData(data.meta);
+            QBuffer overrideBuffer;
+            overrideBuffer.setData(data.override);
+            QList<QIODevice *> overrides;
+            if (!data.override.isEmpty() && overrideBuffer.open(QIODevice::ReadOnly))
+                overrides << &overrideBuffer;
+            if (buffer.open(QIODevice::ReadOnly) && file->meta()->load(&buffer, overrides)
+                    && file->globalCache()->load(m_localPrefix)) {
+                return file;
+            }
+            qCWarning(cfLog) << "Failed to load from the meta database, resource:" << m_key.toString() << "appid:" << appid;
+        }
+    }
+
+    std::unique_ptr<DConfigFile> file(new DConfigFile(outerAppid, m_fileName, m_subpath));
+    file->globalCache()->setCachePathPrefix(configPrefixPath() + "/global");
+    if (!file->load(m_localPrefix))
+        return nullptr;
+
+    return file;
+}
+
+static uint keyIndexHash(const ConfigKeyIndex &index)
+{
+    // independent of the iteration order.
+    uint hash = static_cast<uint>(index.size());
+    for (auto iter = index.cbegin(); iter != index.cend(); ++iter) {
+        hash += qHash(iter.key()) ^ (static_cast<uint>(iter.value().flags) * 31u
+                                     + static_cast<uint>(iter.value().permissions));
+    }
+    return hash;
+}
+
+/*
+  \internal
+
+    \breaf 返回内容相同的已有索引，同一描述文件的公共配置、各应用及子目录的配置共用一份索引，
+    只被池引用的索引在查找时移除
+*/
+static ConfigKeyIndex internKeyIndex(const ConfigKeyIndex &index)
+{
+    static QMutex mutex;
+    static QMultiHash<uint, ConfigKeyIndex> pool;
+    static int sweepSize = 64;
+
+    QMutexLocker locker(&mutex);
+    if (pool.size() > sweepSize) {
+        for (auto iter = pool.begin(); iter != pool.end(); ) {
+            iter = iter.value().isDetached() ? pool.erase(iter) : std::next(iter);
+        }
+        sweepSize = qMax(64, pool.size() * 2);
+    }
+
+    const uint hash = keyIndexHash(index);
+    for (auto iter = pool.find(hash); iter != pool.end() && iter.key() == hash; ) {
+        if (iter.value().isDetached()) {
+            iter = pool.erase(iter);
+        } else if (iter.value() == index) {
+            return iter.value();
+        } else {
+            ++iter;
+        }
+    }
+    pool.insert(hash, index);
+    return index;
+}
+
+/*!
+ \internal
+ \brief 建立配置项索引，使查询配置项是否存在及其属性时无需遍历描述文件
+ */
+void DSGConfigResource::updateKeyIndex(const ResourceKey &key, DConfigFile *file)
+{
+    auto meta = file->meta();
+    const auto keys = meta->keyList();
+    ConfigKeyIndex index;
+    index.reserve(keys.size());
+    for (const auto &item : keys) {
+        index.insert(item, ConfigKeyInfo{meta->flags(item), meta->permissions(item)});
+    }
+    m_keyIndexes.insert(key, internKeyIndex(index));
+}
+
 DConfigCache *DSGConfigResource::getOrCreateCache(const QString &appid, const uint uid)
 {
     const auto connKey = getConnectionKey(getResourceKey(appid, m_key), uid);
@@ -252,7 +975,7 @@ DConfigCache *DSGConfigResource::getOrCreateCache(const QString &appid, const ui
         return cache;
 
     if (auto cache = createCache(appid, uid)) {
-        m_caches.insert(connKey, cache);
+        insertCache(connKey, cache);
         return cache;
     }
     return nullptr;
@@ -264,8 +987,16 @@ DConfigCache *DSGConfigResource::createCache(const QString &appid, const uint ui
     if (auto file = getFile(resourceKey)) {
         std::unique_ptr<DConfigCache> cache(file->createUserCache(uid));
         cache->setCachePathPrefix(configPrefixPath() + QString("/%1").arg(uid));
-        if (cache->load(m_localPrefix))
-            return cache.release();
+        if (!cache->load(m_localPrefix))
+            return nullptr;
+
+        // the released cache may not be saved yet.
+        const auto &cacheKey = ConfigSyncRequestCache::userKey(getConnectionKey(resourceKey, uid));
+        if (auto released = m_persister ? m_persister->released(cacheKey.toString()) : nullptr) {
+            if (released->cache && mergeCache(cache.get(), released->cache.get(), appid))
+                markDirty(cacheKey);
+        }
+        return cache.release();
     }
     return nullptr;
 }
@@ -280,63 +1011,102 @@ DConfigCache *DSGConfigResource::getCache(const ConnKey &key) const
     return m_caches.value(key);
 }
 
-/*
-    @breaf Get all Connectons expect application independent Connection.
-*/
-QList<DSGConfigConn *> DSGConfigResource::specificAppConns() const
+/*!
+ \brief 获取配置项的属性
+ \a resourceKey 资源ID
+ \a key 配置项名称
+ \return 资源未加载或配置项不存在时返回空
+ */
+const ConfigKeyInfo *DSGConfigResource::keyInfo(const ResourceKey &resourceKey, const QString &key) const
 {
-    QList<DSGConfigConn *> result;
-    for (auto iter = m_conns.begin(); iter != m_conns.end(); ++iter) {
-        if (isGenericResourceConn(iter.key()))
-            continue;
-        result << iter.value();
-    }
-    return result;
+    auto index = m_keyIndexes.constFind(resourceKey);
+    if (index == m_keyIndexes.constEnd())
+        return nullptr;
+
+    auto iter = index->constFind(key);
+    if (iter == index->constEnd())
+        return nullptr;
+
+    return &iter.value();
 }
 
-bool DSGConfigResource::cacheExist(const ResourceKey &key) const
+void DSGConfigResource::insertConn(const ConnKey &key, DSGConfigConn *conn)
+{
+    m_conns.insert(key, conn);
+    m_connsByResource[getResourceKey(key)].insert(key, conn);
+    m_connsByUid[getConnectionKey(key)].insert(key);
+    if (!isGenericResourceConn(key))
+        m_specificAppConns.insert(key, conn);
+}
+
+void DSGConfigResource::eraseConn(const ConnKey &key)
 {
-    for (const auto &item : m_caches.keys()) {
-        if (getResourceKey(item) == key)
-            return true;
+    if (!m_conns.remove(key))
+        return;
+
+    const auto &resourceKey = getResourceKey(key);
+    auto conns = m_connsByResource.find(resourceKey);
+    if (conns != m_connsByResource.end()) {
+        conns->remove(key);
+        if (conns->isEmpty())
+            m_connsByResource.erase(conns);
     }
-    return false;
+    auto uidConns = m_connsByUid.find(getConnectionKey(key));
+    if (uidConns != m_connsByUid.end()) {
+        uidConns->remove(key);
+        if (uidConns->isEmpty())
+            m_connsByUid.erase(uidConns);
+    }
+    m_specificAppConns.remove(key);
 }
 
-QList<DConfigCache *> DSGConfigResource::cachesOfTheResource(const ResourceKey &resourceKey) const
+void DSGConfigResource::insertCache(const ConnKey &key, DConfigCache *cache)
 {
-    QList<DConfigCache *> result;
-    for (auto iter = m_caches.begin(); iter != m_caches.end(); ++iter) {
-        if (getResourceKey(iter.key()) != resourceKey)
-            continue;
-        result << iter.value();
+    m_caches.insert(key, cache);
+    m_cachesByResource[getResourceKey(key)].insert(key, cache);
+}
+
+void DSGConfigResource::eraseCache(const ConnKey &key)
+{
+    if (!m_caches.remove(key))
+        return;
+
+    auto caches = m_cachesByResource.find(getResourceKey(key));
+    if (caches != m_cachesByResource.end()) {
+        caches->remove(key);
+        if (caches->isEmpty())
+            m_cachesByResource.erase(caches);
     }
-    return result;
+}
+
+/*
+    @breaf Get all Connectons expect application independent Connection.
+*/
+QList<DSGConfigConn *> DSGConfigResource::specificAppConns() const
+{
+    return m_specificAppConns.values();
+}
+
+bool DSGConfigResource::cacheExist(const ResourceKey &key) const
+{
+    return m_cachesByResource.contains(key);
 }
 
 QList<DSGConfigConn *> DSGConfigResource::connsOfTheResource(const ResourceKey &resourceKey) const
 {
-    QList<DSGConfigConn *> result;
-    for (auto iter = m_conns.begin(); iter != m_conns.end(); ++iter) {
-        if (getResourceKey(iter.key()) != resourceKey)
-            continue;
-        result << iter.value();
-    }
-    return result;
+    return m_connsByResource.value(resourceKey).values();
 }
 
 void DSGConfigResource::onValueChanged(const QString &key)
 {
     if (auto conn = qobject_cast<DSGConfigConn*>(sender())) {
         do {
-            const auto &resouceKey = getResourceKey(conn->key());
-            auto file = getFile(resouceKey);
+            const auto info = keyInfo(conn->resourceKey(), key);
             // global field changed don't cause user field to save, but `valueChanged` signal is emit.
-            if (file && Q_UNLIKELY(file->meta()->flags(key).testFlag(DConfigFile::Global)))
+            if (info && Q_UNLIKELY(info->flags.testFlag(DConfigFile::Global)))
                 break;
 
-            if (Q_LIKELY(m_syncRequestCache))
-                m_syncRequestCache->pushRequest(ConfigSyncRequestCache::userKey(conn->key()));
+            requestSync(ConfigSyncRequestCache::userKey(conn->key()), key, getConnectionKey(conn->key()));
         } while (false);
 
         // to emit generic configuration's valueChanged if valueChanged is emited from generic configuration resource.
@@ -353,16 +1123,18 @@ void DSGConfigResource::onValueChanged(const QString &key)
 void DSGConfigResource::doUpdateGenericConfigValueChanged(const QString &key, const ConnKey &connKey)
 {
 //    only generic configuration resource to emit generic configuration's valueChanged.
-    auto file = getFile(getResourceKey(connKey));
-    if (!file)
+    const auto &resourceKey = getResourceKey(connKey);
+    if (!getFile(resourceKey))
         return;
 
-    const bool isGlobal = file->meta()->flags(key).testFlag(DConfigFile::Global);
+    const auto info = keyInfo(resourceKey, key);
+    const bool isGlobal = info && info->flags.testFlag(DConfigFile::Global);
     const auto uid = getConnectionKey(connKey);
     for (auto conn : specificAppConns()) {
         if (!conn->containsWithoutProp(key))
             continue;
 
+        conn->invalidateValue(key);
         if (isGlobal && uid == getConnectionKey(conn->key())) {
             doGlobalValueChanged(key, getResourceKey(conn->key()));
         } else {
@@ -373,10 +1145,9 @@ void DSGConfigResource::doUpdateGenericConfigValueChanged(const QString &key, co
 
 void DSGConfigResource::doGlobalValueChanged(const QString &key, const ResourceKey &resourceKey)
 {
-    if (Q_LIKELY(m_syncRequestCache))
-        m_syncRequestCache->pushRequest(ConfigSyncRequestCache::globalKey(resourceKey));
     // emit valueChanged of all conns for the resource.
     for (auto conn : connsOfTheResource(resourceKey)) {
+        conn->invalidateValue(key);
         emit conn->valueChanged(key);
     }
 }
@@ -384,33 +1155,101 @@ void DSGConfigResource::doGlobalValueChanged(const QString &key, const ResourceK
 /*
   \internal
 
-    \breaf 重新解析缓存对象
+    \breaf 重新解析缓存对象，只处理描述文件中移除或变化的配置项，返回是否移除了缓存中的值
 */
-void DSGConfigResource::repareCache(DConfigCache *cache, DConfigMeta *oldMeta, DConfigMeta *newMeta)
+bool DSGConfigResource::repareCache(DConfigCache *cache, const ConfigMetaDiff &diff, DConfigMeta *oldMeta, DConfigMeta *newMeta)
 {
-    const auto newMetaKeys = newMeta->keyList();
-    const auto oldMetaKeys = oldMeta->keyList();
-    const QSet<QString> &newKeyList = {newMetaKeys.begin(), newMetaKeys.end()};
-    const QSet<QString> &oldKeyList = {oldMetaKeys.begin(), oldMetaKeys.end()};
-
+    const auto cachedKeys = cache->keyList();
+    const QSet<QString> cached = {cachedKeys.begin(), cachedKeys.end()};
+    bool removed = false;
     // 配置项已经被移除，oldMeta - newMeta，移除cache值
-    const auto subtractKeys = oldKeyList - (newKeyList);
-    for (const auto &key :subtractKeys) {
+    for (const auto &key : diff.removedKeys) {
+        removed |= cached.contains(key);
         cache->remove(key);
         qDebug(cfLog, "Cache removed because of meta item removed, resource:%s, uid:%d, key:%s.",
-               qPrintable(m_key), cache->uid(), qPrintable(key));
+               qPrintable(m_key.toString()), cache->uid(), qPrintable(key));
     }
     // 权限变化，ReadWrite -> ReadOnly，移除cache值
-    auto intersectKeys = newKeyList;
-    intersectKeys = intersectKeys.intersect(oldKeyList);
-    for(const auto &key :intersectKeys) {
+    for (const auto &key : diff.changedKeys) {
+        if (diff.removedKeys.contains(key))
+            continue;
+
         if (newMeta->permissions(key) == DConfigFile::ReadOnly &&
                 oldMeta->permissions(key) == DConfigFile::ReadWrite) {
+            removed |= cached.contains(key);
             cache->remove(key);
             qDebug(cfLog, "Cache removed because of permissions changed from readwrite to readonly, resource:%s,uid:%d,key:%s.",
-                   qPrintable(m_key), cache->uid(), qPrintable(key));
+                   qPrintable(m_key.toString()), cache->uid(), qPrintable(key));
         }
     }
+    return removed;
+}
+
+/*
+  \internal
+
+    \breaf 将current中与cache不同的配置项合并到cache中，相同的配置项保留原有的修改者及修改时间，
+    用于合并解析描述文件期间修改的全局缓存及释放后还未保存的缓存
+    \return 有配置项被修改时返回true
+*/
+bool DSGConfigResource::mergeCache(DConfigCache *cache, DConfigCache *current, const QString &appid) const
+{
+    bool changed = false;
+    const auto currentKeys = current->keyList();
+    const QSet<QString> currentKeySet = {currentKeys.begin(), currentKeys.end()};
+    for (const auto &key : cache->keyList()) {
+        if (!currentKeySet.contains(key)) {
+            cache->remove(key);
+            changed = true;
+        }
+    }
+    const auto &outerAppid = innerAppidToOuter(appid);
+    for (const auto &key : currentKeys) {
+        const auto &value = current->value(key);
+        const auto serial = current->serial(key);
+        if (cache->value(key) == value && cache->serial(key) == serial)
+            continue;
+
+        cache->setValue(key, value, serial, current->uid(), outerAppid);
+        changed = true;
+    }
+    return changed;
+}
+
+/*
+  \internal
+
+    \breaf 比较新旧描述文件，得到新增、移除及默认值、权限、标记等属性变化的配置项，
+    changedKeys包含移除的配置项，不包含新增的配置项
+*/
+ConfigMetaDiff DSGConfigResource::diffMeta(DConfigMeta *oldMeta, DConfigMeta *newMeta)
+{
+    ConfigMetaDiff diff;
+    const auto newMetaKeys = newMeta->keyList();
+    const QSet<QString> newKeyList = {newMetaKeys.begin(), newMetaKeys.end()};
+    const auto oldMetaKeys = oldMeta->keyList();
+    QSet<QString> oldKeyList;
+    oldKeyList.reserve(oldMetaKeys.size());
+    for (const auto &key : oldMetaKeys) {
+        oldKeyList.insert(key);
+        if (!newKeyList.contains(key)) {
+            diff.removedKeys.insert(key);
+            diff.changedKeys << key;
+            continue;
+        }
+
+        if (oldMeta->value(key) != newMeta->value(key)
+                || oldMeta->permissions(key) != newMeta->permissions(key)
+                || oldMeta->flags(key) != newMeta->flags(key)
+                || oldMeta->serial(key) != newMeta->serial(key)) {
+            diff.changedKeys << key;
+        }
+    }
+    for (const auto &key : newMetaKeys) {
+        if (!oldKeyList.contains(key))
+            diff.addedKeys << key;
+    }
+    return diff;
 }
 
 GenericResourceKey DSGConfigResource::key() const
@@ -421,26 +1260,37 @@ GenericResourceKey DSGConfigResource::key() const
 void DSGConfigResource::removeConn(const ConnKey &connKey)
 {
     if (auto conn = getConn(connKey)) {
-        m_conns.remove(connKey);
+        eraseConn(connKey);
+        if (m_connDispatcher)
+            m_connDispatcher->removeConn(conn);
         conn->deleteLater();
     }
 
     if (auto cache = getCache(connKey)) {
-        cache->save(m_localPrefix);
-        m_caches.remove(connKey);
-        delete cache;
+        const auto &cacheKey = ConfigSyncRequestCache::userKey(connKey);
+        DSGConfigPersister::Snapshot content;
+        content.cache.reset(cache);
+        persistReleased(cacheKey, std::move(content));
+        forgetCache(cacheKey);
+        eraseCache(connKey);
     }
 
     const auto resourceKey = getResourceKey(connKey);
     if (auto file = getFile(resourceKey)) {
         if (!cacheExist(resourceKey)) {
-            file->save(m_localPrefix);
+            const auto &cacheKey = ConfigSyncRequestCache::globalKey(resourceKey);
+            DSGConfigPersister::Snapshot content;
+            content.file.reset(file);
+            persistReleased(cacheKey, std::move(content));
+            forgetCache(cacheKey);
             m_files.remove(resourceKey);
-            delete file;
+            ConfigKeyAtoms::deref(resourceKey.appid);
+            m_durabilities.remove(resourceKey);
+            m_keyIndexes.remove(resourceKey);
         }
     }
 
-    qDebug(cfLog, "Removed connection:%s, remaining %d connection.", qPrintable(connKey), m_conns.count());
+    qDebug(cfLog, "Removed connection:%s, remaining %d connection.", qPrintable(connKey.toString()), m_conns.count());
 }
 
 bool DSGConfigResource::isEmptyConn() const
@@ -448,50 +1298,71 @@ bool DSGConfigResource::isEmptyConn() const
     return m_conns.count() <= 0;
 }
 
-void DSGConfigResource::save()
+/*!
+ \brief 保存所有配置文件及缓存，包括日志中的修改
+ \a callback 保存完成后回调
+ */
+void DSGConfigResource::save(const DSGConfigPersister::Callback &callback)
 {
-    qDebug(cfLog, "Save resource's cache for [%s], and cache count:%d", qPrintable(m_key), m_caches.count());
-    for (auto item : m_files)
-        item->save(m_localPrefix);
-
-    for (auto item : m_caches)
-        item->save(m_localPrefix);
+    qDebug(cfLog, "Save resource's cache for [%s], and cache count:%d", qPrintable(m_key.toString()), m_caches.count());
+    QList<ConfigCacheKey> keys;
+    for (auto iter = m_files.cbegin(); iter != m_files.cend(); ++iter)
+        keys << ConfigSyncRequestCache::globalKey(iter.key());
+    for (auto iter = m_caches.cbegin(); iter != m_caches.cend(); ++iter)
+        keys << ConfigSyncRequestCache::userKey(iter.key());
+
+    // all the changes in the journal are saved.
+    m_journalTimer->stop();
+    m_journaledCaches.clear();
+    const auto segment = m_journal.rotate();
+    persist(keys, [segment, path = m_journal.path(), callback](bool saved) {
+        if (saved)
+            DSGConfigJournal::removeSegments(path, segment);
+        if (callback)
+            callback(saved);
+    });
 }
 
-void DSGConfigResource::save(const QString &appid)
+/*!
+ \brief 保存应用的配置文件及所有缓存
+ \a callback 保存完成后回调
+ */
+void DSGConfigResource::save(const QString &appid, const DSGConfigPersister::Callback &callback)
 {
     const auto &resourceKey = getResourceKey(appid, m_key);
-    if (auto file = getFile(resourceKey))
-        file->save(m_localPrefix);
+    QList<ConfigCacheKey> keys;
+    if (getFile(resourceKey))
+        keys << ConfigSyncRequestCache::globalKey(resourceKey);
 
-    for (auto item : cachesOfTheResource(resourceKey)) {
-        item->save(m_localPrefix);
-    }
+    const auto &caches = m_cachesByResource.value(resourceKey);
+    for (auto iter = caches.cbegin(); iter != caches.cend(); ++iter)
+        keys << ConfigSyncRequestCache::userKey(iter.key());
+
+    persist(keys, callback);
 }
 
 void DSGConfigResource::onGlobalValueChanged(const QString &key)
 {
     if (auto conn = qobject_cast<DSGConfigConn*>(sender())) {
         const auto &resourceKey = getResourceKey(conn->key());
+        requestSync(ConfigSyncRequestCache::globalKey(resourceKey), key, getConnectionKey(conn->key()));
         doGlobalValueChanged(key, resourceKey);
+
+        // application's configuration may fall back to the generic global value.
+        if (isGenericResourceConn(conn->key())) {
+            for (auto item : specificAppConns())
+                item->invalidateValue(key);
+        }
     }
 }
 
 /*!
  \brief 获取指定用户ID的所有连接
- 遍历所有连接，返回属于指定用户的连接键列表
+ 通过按uid维护的索引返回属于指定用户的连接键列表
  \a uid 用户ID
  \return 属于该用户的连接键列表
  */
 QList<ConnKey> DSGConfigResource::getConnectionsByUid(const uint uid) const
 {
-    QList<ConnKey> userConnections;
-    for (auto iter = m_conns.begin(); iter != m_conns.end(); ++iter) {
-        const ConnKey &connKey = iter.key();
-        const uint connUid = getConnectionKey(connKey);
-        if (connUid == uid) {
-            userConnections.append(connKey);
-        }
-    }
-    return userConnections;
+    return m_connsByUid.value(uid).values();
 }
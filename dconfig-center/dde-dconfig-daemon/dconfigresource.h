@@ -5,10 +5,18 @@
 #pragma once
 
 #include "dconfig_global.h"
+#include "dconfigjournal.h"
+#include "dconfigpersister.h"
+#include "dconfigrefmanager.h"
 #include <dtkcore_global.h>
+#include <optional>
+#include <memory>
 #include <QObject>
+#include <QHash>
+#include <QSet>
 #include <QDBusObjectPath>
 #include <QDBusContext>
+#include <DConfigFile>
 
 DCORE_BEGIN_NAMESPACE
 class DConfigFile;
@@ -17,8 +25,40 @@ class DConfigCache;
 DCORE_END_NAMESPACE
 
 DCORE_USE_NAMESPACE
+
+// 配置项的属性，随描述文件加载或重新解析时一同建立
+struct ConfigKeyInfo
+{
+    DConfigFile::Flags flags;
+    DConfigFile::Permissions permissions = DConfigFile::ReadOnly;
+
+    bool operator==(const ConfigKeyInfo &other) const
+    {
+        return flags == other.flags && permissions == other.permissions;
+    }
+};
+// 内容相同的索引在不同的appid及子目录间共享
+using ConfigKeyIndex = QHash<QString, ConfigKeyInfo>;
+
+// 重新解析时新旧描述文件的差异，只有这些配置项的值可能变化
+struct ConfigMetaDiff
+{
+    QStringList addedKeys;
+    QSet<QString> removedKeys;
+    // 移除的或默认值、权限、标记、序列号变化的配置项
+    QStringList changedKeys;
+
+    bool isEmpty() const
+    {
+        return addedKeys.isEmpty() && changedKeys.isEmpty();
+    }
+};
+
+class QTimer;
 class DSGConfigConn;
-class ConfigSyncRequestCache;
+class ServiceCredentialCache;
+class DSGConfigConnDispatcher;
+class DSGConfigMetaDatabase;
 /**
  * @brief The DSGConfigResource class
  * 管理单个资源的所有链接和链接需要的配置功能，包括不同应用和应用间的配置
@@ -35,6 +75,7 @@ public:
     GenericResourceKey key() const;
     DConfigFile *getFile(const ResourceKey &key) const;
     DConfigCache *getCache(const ConnKey &key) const;
+    const ConfigKeyInfo *keyInfo(const ResourceKey &resourceKey, const QString &key) const;
 
     DSGConfigConn *getConn(const QString &appid, const uint uid) const;
     DSGConfigConn *getConn(const ConnKey &key) const;
@@ -48,14 +89,33 @@ public:
     DConfigCache *noAppidCache(const uint uid) const;
     DConfigFile *noAppidFile() const;
 
-    void save();
-    void save(const QString &appid);
+    void save(const DSGConfigPersister::Callback &callback = DSGConfigPersister::Callback());
+    void save(const QString &appid, const DSGConfigPersister::Callback &callback = DSGConfigPersister::Callback());
 
     bool reparse(const QString &appid);
+    std::unique_ptr<DConfigFile> prepareReparse(const QString &appid);
+    bool applyReparse(const QString &appid, std::unique_ptr<DConfigFile> config);
 
     void setSyncRequestCache(ConfigSyncRequestCache *cache);
     void doSyncConfigCache(const ConfigCacheKey &key);
 
+    const DSGConfigJournal &journal() const;
+    void setJournalCompactionThreshold(const qint64 size, const int ms);
+    void compactJournal(const DSGConfigPersister::Callback &callback = DSGConfigPersister::Callback());
+    void removeUserJournal(const uint uid);
+    static void removeUserJournals(const uint uid, const QSet<QString> &excludes);
+
+    void setConnDispatcher(DSGConfigConnDispatcher *dispatcher);
+
+    ConfigSyncRequestCache::Durability durability(const ResourceKey &key) const;
+    bool isDirty(const ConfigCacheKey &key) const;
+    quint64 skippedWrites() const;
+
+    void setCredentialCache(ServiceCredentialCache *cache);
+    void setMetaDatabase(const DSGConfigMetaDatabase *database);
+    void setPersister(DSGConfigPersister *persister);
+    ServiceCredentialCache *credentialCache() const;
+
     QList<ConnKey> getConnectionsByUid(const uint uid) const;
 
 Q_SIGNALS:
@@ -69,18 +129,36 @@ private Q_SLOTS:
     void onReleaseChanged(const ConnServiceName &service);
 
 private:
-    void repareCache(DConfigCache *cache, DConfigMeta *oldMeta, DConfigMeta *newMeta);
+    bool repareCache(DConfigCache *cache, const ConfigMetaDiff &diff, DConfigMeta *oldMeta, DConfigMeta *newMeta);
+    bool mergeCache(DConfigCache *cache, DConfigCache *current, const QString &appid) const;
+    static ConfigMetaDiff diffMeta(DConfigMeta *oldMeta, DConfigMeta *newMeta);
 
     void doUpdateGenericConfigValueChanged(const QString &key, const ConnKey &connKey);
 
     void doGlobalValueChanged(const QString &key, const ResourceKey &resourceKey);
 
+    void persist(const QList<ConfigCacheKey> &keys, const DSGConfigPersister::Callback &callback = DSGConfigPersister::Callback());
+    void onPersisted(const QList<QPair<ConfigCacheKey, QByteArray>> &contents, const bool saved);
+    void markDirty(const ConfigCacheKey &key);
+    void forgetCache(const ConfigCacheKey &key);
+    void persistReleased(const ConfigCacheKey &key, DSGConfigPersister::Snapshot &&content);
+    static QByteArray cacheContentHash(DConfigCache *cache);
+    void requestSync(const ConfigCacheKey &cacheKey, const QString &key, const uint uid);
+    bool appendJournal(const ConfigCacheKey &cacheKey, const QString &key, const uint uid);
+    void recoverJournal();
+
+    ConfigSyncRequestCache::Durability loadDurability(const QString &appid, DConfigFile *file) const;
+    void updateKeyIndex(const ResourceKey &key, DConfigFile *file);
     DConfigFile *getOrCreateFile(const QString &appid);
+    std::unique_ptr<DConfigFile> loadFile(const QString &appid) const;
     DConfigCache *createCache(const QString &appid, const uint uid);
     DConfigCache *getOrCreateCache(const QString &appid, const uint uid);
+    void insertConn(const ConnKey &key, DSGConfigConn *conn);
+    void eraseConn(const ConnKey &key);
+    void insertCache(const ConnKey &key, DConfigCache *cache);
+    void eraseCache(const ConnKey &key);
     QList<DSGConfigConn *> specificAppConns() const;
     bool cacheExist(const ResourceKey &key) const;
-    QList<DConfigCache *> cachesOfTheResource(const ResourceKey &resourceKey) const;
     QList<DSGConfigConn *> connsOfTheResource(const ResourceKey &resourceKey) const;
 
 private:
@@ -88,10 +166,42 @@ private:
     QString m_fileName;
     QString m_subpath;
     QString m_localPrefix;
+    // 是否存在公共配置，在资源更新时失效
+    mutable std::optional<bool> m_canFallbackToGeneric;
 
     QMap<ResourceKey, DConfigFile *> m_files;
+    QHash<ResourceKey, ConfigKeyIndex> m_keyIndexes;
+    // 描述文件中的持久化等级，决定修改后多久保存
+    QHash<ResourceKey, ConfigSyncRequestCache::Durability> m_durabilities;
     QMap<ConnKey, DConfigCache *> m_caches;
     QMap<ConnKey, DSGConfigConn *> m_conns;
 
+    // m_conns and m_caches's secondary indexes, maintained by insertConn/eraseConn and insertCache/eraseCache.
+    QHash<ResourceKey, QHash<ConnKey, DSGConfigConn *>> m_connsByResource;
+    QHash<ResourceKey, QHash<ConnKey, DConfigCache *>> m_cachesByResource;
+    QHash<uint, QSet<ConnKey>> m_connsByUid;
+    QHash<ConnKey, DSGConfigConn *> m_specificAppConns;
+
     ConfigSyncRequestCache *m_syncRequestCache = nullptr;
+    ServiceCredentialCache *m_credentialCache = nullptr;
+    DSGConfigConnDispatcher *m_connDispatcher = nullptr;
+    const DSGConfigMetaDatabase *m_metaDatabase = nullptr;
+    DSGConfigPersister *m_persister = nullptr;
+
+    // 修改配置项时追加到日志，超出大小或时间后合并到缓存文件
+    DSGConfigJournal m_journal;
+    bool m_journalRecovered = false;
+    bool m_journalCompacting = false;
+    // 合并期间再次请求合并，当前的合并完成后合并之后追加的记录
+    bool m_journalFollowUp = false;
+    QList<DSGConfigPersister::Callback> m_journalFollowUpCallbacks;
+    QSet<ConfigCacheKey> m_journaledCaches;
+    QTimer *m_journalTimer = nullptr;
+    qint64 m_journalCompactionSize;
+
+    // 修改后未保存的缓存，只保存这些缓存
+    QSet<ConfigCacheKey> m_dirtyCaches;
+    // 上次保存成功的缓存内容的哈希，内容未变化时不再写入
+    QHash<ConfigCacheKey, QByteArray> m_persistedHashes;
+    quint64 m_skippedWrites = 0;
 };
@@ -6,14 +6,22 @@
 #include "dconfigresource.h"
 #include "dconfigconn.h"
 #include "dconfigrefmanager.h"
+#include "dconfigconndispatcher.h"
+#include "dconfigwatcher.h"
+#include "dconfigsignatureindex.h"
+#include "dconfigpersister.h"
 #include <QDBusMessage>
+#include <QThread>
+#include <QThreadPool>
 #include <QDBusConnection>
 #include <QDBusConnectionInterface>
 #include <QCoreApplication>
 #include <QDebug>
 #include <QLoggingCategory>
 #include <QDir>
+#include <QElapsedTimer>
 #include <QFile>
+#include <QPointer>
 
 #include "configmanager_adaptor.h"
 
@@ -30,6 +38,7 @@ static void registerMetaType ()
 {
     qRegisterMetaType<ConnServiceName>("ConnServiceName");
     qRegisterMetaType<ConnKey>("ConnKey");
+    registerConfigDBusMetaTypes();
 }
 
 DSGConfigServer::DSGConfigServer(QObject *parent)
@@ -37,11 +46,18 @@ DSGConfigServer::DSGConfigServer(QObject *parent)
       m_watcher(nullptr),
       m_refManager(new RefManager(this))
     , m_syncRequestCache(new ConfigSyncRequestCache(this))
+    , m_reparsePool(new QThreadPool(this))
+    , m_persister(new DSGConfigPersister(this))
 {
+    m_startupTimer.start();
     connect(this, &DSGConfigServer::releaseResource, this, &DSGConfigServer::onReleaseResource);
     connect(m_refManager, &RefManager::releaseResource, this, &DSGConfigServer::releaseResource);
     connect(this, &DSGConfigServer::tryExit, this, &DSGConfigServer::onTryExit);
     connect(m_syncRequestCache, &ConfigSyncRequestCache::syncConfigRequest, this, &DSGConfigServer::doSyncConfigCache);
+    m_credentialCache.setWatchHandler([this](const QDBusConnection &connection, const ConnServiceName &service,
+                                             const ServiceCredential &credential) {
+        watchService(connection, service, &credential);
+    });
 }
 
 DSGConfigServer::~DSGConfigServer()
@@ -50,12 +66,23 @@ DSGConfigServer::~DSGConfigServer()
     exit();
 }
 
+// 退出时等待缓存保存完成的时间
+static constexpr int PersistTimeout = 5000;
+
 void DSGConfigServer::exit()
 {
+    waitForInitialized();
+    m_reparsePool->waitForDone();
+    m_reparseGenerations.clear();
     m_refManager->destroy();
+    m_persister->beginBatch();
     qDeleteAll(m_resources);
+    m_persister->endBatch();
     m_resources.clear();
     m_syncRequestCache->clear();
+    m_credentialCache.clear();
+    // the caches of the released resources are saved in the persistence thread.
+    m_persister->waitForDone(PersistTimeout);
 }
 
 /*
@@ -79,15 +106,103 @@ bool DSGConfigServer::registerService()
         qWarning() << QString("Can't register to the D-Bus object.");
         return false;
     }
+    if (!m_connDispatcher)
+        m_connDispatcher = new DSGConfigConnDispatcher(bus, this);
+
     return true;
 }
 
+// 持久化的文件签名，未设置STATE_DIRECTORY时不保存
+static QString signatureIndexPath()
+{
+    const char *stateDirectory("STATE_DIRECTORY");
+    if (qEnvironmentVariableIsEmpty(stateDirectory))
+        return QString();
+
+    return QString("%1/file-signatures.index").arg(qEnvironmentVariable(stateDirectory));
+}
+
+/*!
+ \brief 在工作线程中初始化文件签名及描述文件目录，不阻塞服务的请求，
+ 初始化完成前收到的reload及文件变化在完成后处理
+ */
 void DSGConfigServer::initialize()
 {
+    if (m_initializeThread || m_initialized)
+        return;
+
     // Initialize file signatures to avoid unnecessary updates on first reload
     qCInfo(cfLog()) << "Initializing file signatures on service startup";
-    m_fileSignatures = allConfigureFileSignatures(m_localPrefix);
-    qCInfo(cfLog()) << "Initialized file signatures completed, size: " << m_fileSignatures.size();
+    const auto &indexPath = signatureIndexPath();
+    const auto &roots = configureDirectories(m_localPrefix);
+    const auto &metaDirs = DConfigMeta::genericMetaDirs(m_localPrefix);
+    const auto &databasePath = metaDatabasePath(m_localPrefix);
+    auto result = std::make_shared<InitializeResult>();
+    m_initializeResult = result;
+    m_initializeThread = QThread::create([result, indexPath, roots, metaDirs, databasePath]() {
+        QElapsedTimer timer;
+        timer.start();
+        // unchanged directories of the last saved index needn't be read again.
+        result->loaded = !indexPath.isEmpty() && result->signatures.load(indexPath);
+        result->changedCount = result->signatures.scan(roots, result->loaded).size();
+        result->catalog.rebuild(metaDirs, result->signatures.filePaths());
+        if (!indexPath.isEmpty())
+            result->signatures.save(indexPath);
+        if (result->metaDatabase.open(databasePath) && !result->metaDatabase.isUpToDate(result->signatures)) {
+            qCInfo(cfLog()) << "The meta database is out of date, fallback to parsing configuration files.";
+            result->metaDatabase.close();
+        }
+        result->elapsed = timer.elapsed();
+    });
+    m_initializeThread->setObjectName("dconfig-initialize");
+    connect(m_initializeThread, &QThread::finished, this, &DSGConfigServer::onInitialized);
+    connect(m_initializeThread, &QThread::finished, m_initializeThread, &QObject::deleteLater);
+    m_initializeThread->start(QThread::LowPriority);
+}
+
+bool DSGConfigServer::isInitialized() const
+{
+    return m_initialized;
+}
+
+/*!
+ \brief 等待初始化完成，需要完整的文件签名或描述文件目录时调用
+ */
+void DSGConfigServer::waitForInitialized()
+{
+    if (!m_initializeThread)
+        return;
+
+    m_initializeThread->wait();
+    onInitialized();
+}
+
+void DSGConfigServer::onInitialized()
+{
+    if (!m_initializeThread)
+        return;
+
+    m_initializeThread = nullptr;
+    m_initialized = true;
+    const auto result = std::move(m_initializeResult);
+    m_fileSignatures = std::move(result->signatures);
+    m_catalog = std::move(result->catalog);
+    m_metaDatabase.swap(result->metaDatabase);
+    qCInfo(cfLog()) << "Initialized file signatures completed, size: " << m_fileSignatures.size()
+                    << ", loaded from the saved index:" << result->loaded << ", changed:" << result->changedCount
+                    << ", meta database:" << m_metaDatabase.size()
+                    << ", elapsed:" << result->elapsed << "ms, since startup:" << m_startupTimer.elapsed() << "ms";
+
+    if (!m_pendingChangedFiles.isEmpty()) {
+        const auto paths = std::move(m_pendingChangedFiles);
+        m_pendingChangedFiles.clear();
+        onConfigureFilesChanged(paths);
+    }
+    if (m_reloadPending) {
+        m_reloadPending = false;
+        qCInfo(cfLog()) << "Reload configuration files requested while initializing";
+        reload();
+    }
 }
 
 /*!
@@ -165,12 +280,24 @@ void DSGConfigServer::removeUserData(const uint &uid)
         connectionsToRemove.append(userConnections);
 
         for (const ConnKey &connKey : userConnections) {
-            qCDebug(cfLog()) << QString("Found connection to remove: %1").arg(connKey);
+            qCDebug(cfLog()) << QString("Found connection to remove: %1").arg(connKey.toString());
         }
     }
 
+    // 删除日志中此用户的记录，避免服务异常退出后重放日志时重新创建用户的缓存文件
+    QSet<QString> journals;
+    for (auto resource : std::as_const(m_resources)) {
+        if (!resource)
+            continue;
+
+        resource->removeUserJournal(uid);
+        journals.insert(resource->journal().path());
+    }
+    DSGConfigResource::removeUserJournals(uid, journals);
+
     // 逐个删除连接和相关数据
     int removedCount = 0;
+    m_persister->beginBatch();
     for (const ConnKey &connKey : connectionsToRemove) {
         const GenericResourceKey &resourceKey = getGenericResourceKey(connKey);
         auto resource = m_resources.value(resourceKey);
@@ -179,20 +306,19 @@ void DSGConfigServer::removeUserData(const uint &uid)
             resource->removeConn(connKey);
             removedCount++;
 
-            qCInfo(cfLog()) << QString("Removed connection: %1").arg(connKey);
+            qCInfo(cfLog()) << QString("Removed connection: %1").arg(connKey.toString());
 
             // 如果资源没有更多连接，清理资源
             if (resource->isEmptyConn()) {
-                qCInfo(cfLog()) << QString("Removing empty resource: %1").arg(resourceKey);
+                qCInfo(cfLog()) << QString("Removing empty resource: %1").arg(resourceKey.toString());
                 m_resources.remove(resourceKey);
                 resource->deleteLater();
             }
         }
-        }
+    }
 
     // 删除文件系统中的用户配置目录
-    const QString userConfigBasePath = QString("%1/%2").arg(m_localPrefix).arg(configPrefixPath());
-    if (!userConfigBasePath.isEmpty()) {
+    const auto removeCacheDirectory = [uid, userConfigBasePath = QString("%1/%2").arg(m_localPrefix).arg(configPrefixPath())]() {
         const QString userCacheDir = QString("%1/%2").arg(userConfigBasePath).arg(uid);
         QDir cacheDir(userCacheDir);
         if (cacheDir.exists()) {
@@ -202,9 +328,26 @@ void DSGConfigServer::removeUserData(const uint &uid)
                 qCWarning(cfLog()) << QString("Failed to remove user cache directory: %1").arg(userCacheDir);
             }
         }
-    }
-
+    };
     qCInfo(cfLog()) << QString("Successfully removed %1 connections for user UID %2").arg(removedCount).arg(uid);
+
+    // 保存完成后再删除目录，避免删除目录后又写入缓存
+    if (!calledFromDBus()) {
+        m_persister->endBatch();
+        if (!m_persister->waitForDone(PersistTimeout)) {
+            qCWarning(cfLog()) << QString("Timeout to save the caches, keep the user cache directory for UID %1").arg(uid);
+            return;
+        }
+        removeCacheDirectory();
+        return;
+    }
+    // don't block the other clients on a slow disk, reply after the caches are saved.
+    setDelayedReply(true);
+    m_persister->submit({}, m_localPrefix, [reply = message(), bus = connection(), removeCacheDirectory](bool) {
+        removeCacheDirectory();
+        bus.send(reply.createReply());
+    });
+    m_persister->endBatch();
 }
 
 void DSGConfigServer::setLocalPrefix(const QString &localPrefix)
@@ -231,8 +374,18 @@ int DSGConfigServer::resourceSize() const
  */
 QDBusObjectPath DSGConfigServer::acquireManager(const QString &appid, const QString &name, const QString &subpath)
 {
-    const auto &service = calledFromDBus() ? message().service() : "test.service";
-    const uint &uid = calledFromDBus() ? connection().interface()->serviceUid(service).value() : TestUid;
+    uint uid = TestUid;
+    if (calledFromDBus()) {
+        const auto &service = message().service();
+        const auto &credential = m_credentialCache.credential(connection(), service);
+        if (!credential) {
+            QString errorMsg = QString("Can't get the credential of the service %1.").arg(service);
+            sendErrorReply(QDBusError::Failed, errorMsg);
+            qWarning() << qPrintable(errorMsg);
+            return QDBusObjectPath();
+        }
+        uid = credential->uid;
+    }
     return acquireManagerV2(uid, appid, name, subpath);
 }
 
@@ -257,36 +410,97 @@ QDBusObjectPath DSGConfigServer::acquireManagerV2(const uint &uid, const QString
 
     const auto &service = calledFromDBus() ? message().service() : "test.service";
     qCDebug(cfLog, "AcquireManager service:%s, uid:%d, appid:%s", qPrintable(service), uid, qPrintable(appid));
+    QString errorMsg;
+    auto conn = acquireConn(service, uid, appid, name, subpath, errorMsg);
+    if (!conn) {
+        // the names of the failed request aren't used by any resource.
+        ConfigKeyAtoms::sweep();
+        if (calledFromDBus())
+            sendErrorReply(QDBusError::Failed, errorMsg);
+
+        qWarning() << qPrintable(errorMsg);
+        return QDBusObjectPath();
+    }
+
+    addConnWatchedService(service);
+    return QDBusObjectPath(conn->path());
+}
+
+/*!
+ \brief 一次请求多个配置文件管理连接
+ 所有配置在一次调用中加载，单个配置获取失败时对应的路径为"/"，不影响其它配置。
+ \a uid 用户的唯一ID
+ \a resources 配置文件列表
+ \return 与resources一一对应的连接路径
+ */
+QList<QDBusObjectPath> DSGConfigServer::acquireManagers(const uint &uid, const ConfigResourceIdList &resources)
+{
+    struct passwd *pw = getpwuid(uid);
+    if (!pw) {
+        QString errorMsg = QString("User with UID %1 does not exist.").arg(uid);
+        if (calledFromDBus())
+            sendErrorReply(QDBusError::Failed, errorMsg);
+        qWarning() << qPrintable(errorMsg);
+        return {};
+    }
+
+    const auto &service = calledFromDBus() ? message().service() : "test.service";
+    qCDebug(cfLog, "AcquireManagers service:%s, uid:%d, count:%d", qPrintable(service), uid, resources.size());
+    QList<QDBusObjectPath> paths;
+    paths.reserve(resources.size());
+    for (const auto &item : resources) {
+        QString errorMsg;
+        if (auto conn = acquireConn(service, uid, item.appid, item.name, item.subpath, errorMsg)) {
+            paths << QDBusObjectPath(conn->path());
+        } else {
+            qWarning() << qPrintable(errorMsg);
+            paths << QDBusObjectPath("/");
+            ConfigKeyAtoms::sweep();
+        }
+    }
+
+    addConnWatchedService(service);
+    return paths;
+}
+
+/*!
+ \brief 获取或创建连接，并增加服务对此连接的引用
+ \a errorMsg 失败时的错误信息
+ \return 失败时返回空
+ */
+DSGConfigConn *DSGConfigServer::acquireConn(const ConnServiceName &service, const uint uid, const QString &appid,
+                                           const QString &name, const QString &subpath, QString &errorMsg)
+{
     const QString &innerAppid = outerAppidToInner(appid);
-    const GenericResourceKey &genericResourceKey = getGenericResourceKey(name, subpath);
-    DSGConfigResource *resource = resourceObject(genericResourceKey);
+    // look up without interning the names, the resource holds them.
+    quint32 nameId = 0, subpathId = 0;
+    DSGConfigResource *resource = nullptr;
+    if (ConfigKeyAtoms::find(name, &nameId) && ConfigKeyAtoms::find(subpath, &subpathId))
+        resource = resourceObject(GenericResourceKey(nameId, subpathId));
     std::unique_ptr<DSGConfigResource> resourceHolder;
     if (!resource) {
         resource = new DSGConfigResource(name, subpath, m_localPrefix);
         resource->setSyncRequestCache(m_syncRequestCache);
+        resource->setCredentialCache(&m_credentialCache);
+        resource->setMetaDatabase(&m_metaDatabase);
+        resource->setPersister(m_persister);
+        resource->setConnDispatcher(m_connDispatcher);
         resourceHolder.reset(resource);
     }
+    const GenericResourceKey genericResourceKey = resource->key();
     bool loadStatus = resource->load(innerAppid);
     if (!loadStatus) {
         //error
-        QString errorMsg = QString("Can't load resource: %1, for the appid:[%2].").arg(genericResourceKey).arg(appid);
-        if (calledFromDBus())
-            sendErrorReply(QDBusError::Failed, errorMsg);
-
-        qWarning() << qPrintable(errorMsg);
-        return QDBusObjectPath();
+        errorMsg = QString("Can't load resource: %1, for the appid:[%2].").arg(genericResourceKey.toString()).arg(appid);
+        return nullptr;
     }
 
     auto conn = resource->getConn(innerAppid, uid);
     if (!conn) {
         conn = resource->createConn(innerAppid, uid);
         if (!conn) {
-            QString errorMsg = QString("Can't register Connection object:[%1], for the appid:[%2].").arg(genericResourceKey).arg(appid);
-            if (calledFromDBus())
-                sendErrorReply(QDBusError::Failed, errorMsg);
-
-            qWarning() << qPrintable(errorMsg);
-            return QDBusObjectPath();
+            errorMsg = QString("Can't register Connection object:[%1], for the appid:[%2].").arg(genericResourceKey.toString()).arg(appid);
+            return nullptr;
         }
         qCInfo(cfLog, "Created connection:%s", qPrintable(conn->path()));
     } else {
@@ -298,10 +512,12 @@ QDBusObjectPath DSGConfigServer::acquireManagerV2(const uint &uid, const QString
         QObject::connect(resource, &DSGConfigResource::releaseConn, this, &DSGConfigServer::onReleaseChanged);
     }
 
-    addConnWatchedService(service);
     m_refManager->refResource(service, conn->key());
-
-    return QDBusObjectPath(conn->path());
+    if (!m_firstRequestServed) {
+        m_firstRequestServed = true;
+        qCInfo(cfLog()) << "Served the first request after startup:" << m_startupTimer.elapsed() << "ms";
+    }
+    return conn;
 }
 
 /*!
@@ -314,7 +530,7 @@ void DSGConfigServer::onReleaseChanged(const ConnServiceName &service, const Con
     m_refManager->derefResource(service, connKey);
 
     const auto remainingCount = m_refManager->getRefResourceCountOnTheSR(service, connKey);
-    qCInfo(cfLog, "Reduced connection reference service. service:%s, path:%s, remaining reference %d", qPrintable(service), qPrintable(connKey), remainingCount);
+    qCInfo(cfLog, "Reduced connection reference service. service:%s, path:%s, remaining reference %d", qPrintable(service), qPrintable(connKey.toString()), remainingCount);
 }
 
 /*!
@@ -327,11 +543,11 @@ void DSGConfigServer::onReleaseResource(const ConnKey &connKey)
     auto resource = m_resources.value(resourceKey);
     if (!resource)
         return;
-    qCInfo(cfLog, "Remove connection:%s", qPrintable(connKey));
+    qCInfo(cfLog, "Remove connection:%s", qPrintable(connKey.toString()));
     resource->removeConn(connKey);
 
     if (resource->isEmptyConn()) {
-        qCInfo(cfLog, "Remove resource:%s", qPrintable(resourceKey));
+        qCInfo(cfLog, "Remove resource:%s", qPrintable(resourceKey.toString()));
 
         m_resources.remove(resourceKey);
         resource->deleteLater();
@@ -358,6 +574,10 @@ void DSGConfigServer::doSyncConfigCache(const ConfigSyncBatchRequest &request)
 {
     const QList<ConfigCacheKey> &keys = request.data;
     qCInfo(cfLog, "Do sync config cache, keys count:%d", keys.size());
+    // the caches of the request are committed with one disk sync.
+    m_persister->beginBatch();
+    QElapsedTimer timer;
+    timer.start();
     for (auto key: keys) {
         auto resourceKey = getResourceKeyByConfigCache(key);
         const auto genericResourceKey = getGenericResourceKeyByResourceKey(resourceKey);
@@ -365,77 +585,66 @@ void DSGConfigServer::doSyncConfigCache(const ConfigSyncBatchRequest &request)
             resource->doSyncConfigCache(key);
         }
     }
+    // the scheduler adapts the batch size to the latency of the whole batch.
+    QPointer<ConfigSyncRequestCache> scheduler(m_syncRequestCache);
+    m_persister->submit({}, m_localPrefix, [scheduler, timer, count = keys.size()](bool) {
+        if (scheduler)
+            scheduler->reportLatency(count, timer.elapsed());
+    });
+    m_persister->endBatch();
 }
 
 ResourceKey DSGConfigServer::getResourceKeyByConfigCache(const ConfigCacheKey &key)
 {
-    if (ConfigSyncRequestCache::isUserKey(key)) {
+    if (ConfigSyncRequestCache::isUserKey(key))
         return getResourceKey(ConfigSyncRequestCache::getUserKey(key));
-    } else if (ConfigSyncRequestCache::isGlobalKey(key)){
-        return ConfigSyncRequestCache::getGlobalKey(key);
-    }
-    return ResourceKey();
+
+    return ConfigSyncRequestCache::getGlobalKey(key);
 }
 
 ConfigureId DSGConfigServer::getConfigureIdByPath(const QString &path)
 {
     // Use absolute path for parsing, file may not exist (e.g., when deleted)
-    const auto &absolutePath = QFileInfo(path).absoluteFilePath();
+    const auto &absolutePath = QDir::cleanPath(QFileInfo(path).absoluteFilePath());
 
     auto res = getMetaConfigureId(absolutePath);
     if (res.isInValid()) {
         res = getOverrideConfigureId(absolutePath);
     }
     if (!res.isInValid()) {
-        if (isConfigurePath(absolutePath, res.appid))
+        if (isConfigurePath(absolutePath))
             return res;
     }
     return ConfigureId();
 }
 
-static bool isPathInDirectory(const QString &path, const QString &dir) {
-    const QDir targetDir(dir);
-    QDir currentDir(path);
-    while (currentDir != targetDir && !currentDir.isRoot()) {
-        if (!currentDir.cdUp()) {
-            return false;
-        }
-    }
-
-    return (currentDir == targetDir);
-}
+/*
+  \internal
 
-bool DSGConfigServer::isConfigurePath(const QString &path, const QString &appId) const
+    \breaf 路径是否位于描述文件或override目录中，应用的描述文件目录位于描述文件目录中，
+    目录在工作目录或DSG_DATA_DIRS变化时重新建立
+*/
+bool DSGConfigServer::isConfigurePath(const QString &path) const
 {
-    QStringList dirs;
-    const QStringList metaDirs = DConfigMeta::genericMetaDirs(m_localPrefix);
-    dirs << metaDirs;
-
-    if (!appId.isEmpty())
-        dirs << DConfigMeta::applicationMetaDirs(m_localPrefix, appId);
-
-    QStringList overrideDirs {
-        QString("%1/etc/dsg/configs/overrides").arg(m_localPrefix)
-    };
-    for (const auto dir : metaDirs) {
-        overrideDirs << QString("%1/%2/overrides").arg(m_localPrefix).arg(dir);
-    }
-    dirs << overrideDirs;
-
-    for (const auto dir: dirs) {
-        if (isPathInDirectory(path, dir)) {
-            return true;
-        }
+    const auto &dataDirs = qgetenv("DSG_DATA_DIRS");
+    if (m_configureRoots.roots().isEmpty() || m_configureRootsPrefix != m_localPrefix
+            || m_configureRootsDataDirs != dataDirs) {
+        m_configureRoots.setRoots(configureDirectories(m_localPrefix));
+        m_configureRootsPrefix = m_localPrefix;
+        m_configureRootsDataDirs = dataDirs;
     }
-    return false;
+    return m_configureRoots.contains(path);
 }
 
 /*!
  \brief 文件刷新，
  当描述文件被修改或override目录新增、移除、修改文件时，需要重新解析对应的文件内容，
  提供刷新服务，由配置工具调用来运行时刷新提供的文件访问信息。
+ 在线程池中重新解析描述文件，完成后在主线程中替换并通知值变化，同一资源多次更新时只使用最后一次解析的结果，
+ 资源在解析期间被释放或重新创建时丢弃解析的结果。
+ \a callback 完成后在主线程中调用，参数为错误信息
  */
-std::optional<QString> DSGConfigServer::updateInternal(const QString &path)
+void DSGConfigServer::updateInternal(const QString &path, const UpdateCallback &callback)
 {
     qCInfo(cfLog()) << "Update resource:" << path;
 
@@ -445,31 +654,83 @@ std::optional<QString> DSGConfigServer::updateInternal(const QString &path)
            qPrintable(configureInfo.subpath),
            qPrintable(configureInfo.resource));
     if (configureInfo.isInValid()) {
-        return QString("It's illegal resource [%1].").arg(path);
+        callback(QString("It's illegal resource [%1].").arg(path));
+        return;
     }
 
     const GenericResourceKey resourceKey = getGenericResourceKey(configureInfo.resource, configureInfo.subpath);
-    if (auto resource = resourceObject(resourceKey)) {
+    auto resource = resourceObject(resourceKey);
+    const auto &innerAppid = outerAppidToInner(configureInfo.appid);
+    auto config = resource ? resource->prepareReparse(innerAppid) : nullptr;
+    if (!config) {
+        callback(std::nullopt);
+        return;
+    }
+
+    auto job = std::make_shared<ReparseJob>();
+    job->path = path;
+    job->resourceKey = resourceKey;
+    job->resource = resource;
+    job->appid = innerAppid;
+    job->generation = ++m_reparseGenerations[getResourceKey(innerAppid, resourceKey)];
+    job->config = std::move(config);
+    job->callback = callback;
+    m_reparsePool->start([this, job]() {
+        job->loaded = job->config->meta()->load();
+        QMetaObject::invokeMethod(this, [this, job]() {
+            onReparsed(job);
+        }, Qt::QueuedConnection);
+    });
+}
+
+void DSGConfigServer::onReparsed(const std::shared_ptr<ReparseJob> &job)
+{
+    const auto &key = getResourceKey(job->appid, job->resourceKey);
+    if (m_reparseGenerations.value(key) != job->generation) {
+        qCDebug(cfLog()) << "Discard the superseded result of updating:" << job->path;
+        job->callback(std::nullopt);
+        return;
+    }
+    m_reparseGenerations.remove(key);
+
+    if (!job->loaded) {
+        job->callback(QString("Update the resource path[%1] error.").arg(job->path));
+        return;
+    }
+    // the resource may be released or recreated while parsing,
+    // the guarded pointer is cleared when the resource which the job belongs to is deleted.
+    auto resource = job->resource.data();
+    if (resource && resource == resourceObject(job->resourceKey)) {
         qCInfo(cfLog, "Updated the resouce:[%s], for the appid:[%s].",
-               qPrintable(resourceKey),
-               qPrintable(configureInfo.appid));
-        const auto &innerAppid = outerAppidToInner(configureInfo.appid);
-        if (!resource->reparse(innerAppid)) {
-            return QString("Update the resource path[%1] error.").arg(path);
-        }
+               qPrintable(job->resourceKey.toString()),
+               qPrintable(job->appid));
+        resource->applyReparse(job->appid, std::move(job->config));
     }
-    return std::nullopt;
+    job->callback(std::nullopt);
 }
 
 void DSGConfigServer::update(const QString &path)
 {
-    const auto errorMsg = updateInternal(path);
-    if (errorMsg) {
-        qWarning() << *errorMsg;
-        if (calledFromDBus()) {
-            sendErrorReply(QDBusError::Failed, *errorMsg);
-        }
+    waitForInitialized();
+    const auto &absolutePath = QFileInfo(path).absoluteFilePath();
+    m_catalog.update(DConfigMeta::genericMetaDirs(m_localPrefix), absolutePath, QFile::exists(absolutePath));
+    closeMetaDatabase();
+
+    if (!calledFromDBus()) {
+        updateInternal(path, [](const std::optional<QString> &errorMsg) {
+            if (errorMsg)
+                qWarning() << *errorMsg;
+        });
+        return;
     }
+
+    // reply after the resource is updated, other requests are served meanwhile.
+    setDelayedReply(true);
+    updateInternal(path, [reply = message(), bus = connection()](const std::optional<QString> &errorMsg) {
+        if (errorMsg)
+            qWarning() << *errorMsg;
+        bus.send(errorMsg ? reply.createErrorReply(QDBusError::Failed, *errorMsg) : reply.createReply());
+    });
 }
 
 void DSGConfigServer::sync(const QString &path)
@@ -492,9 +753,20 @@ void DSGConfigServer::sync(const QString &path)
            qPrintable(configureInfo.resource));
     const GenericResourceKey resourceKey = getGenericResourceKey(configureInfo.resource, configureInfo.subpath);
     if (auto resource = resourceObject(resourceKey)) {
-        qCInfo(cfLog, "Sync the resouce:[%s], for the appid:[%s].", qPrintable(resourceKey), qPrintable(configureInfo.appid));
+        qCInfo(cfLog, "Sync the resouce:[%s], for the appid:[%s].", qPrintable(resourceKey.toString()), qPrintable(configureInfo.appid));
         const auto &innerAppid = outerAppidToInner(configureInfo.appid);
-        resource->save(innerAppid);
+        if (!calledFromDBus()) {
+            resource->save(innerAppid);
+            return;
+        }
+        // reply after the caches are saved.
+        setDelayedReply(true);
+        resource->save(innerAppid, [reply = message(), bus = connection(), path](bool saved) {
+            const auto &errorMsg = QString("Can't save the resource [%1].").arg(path);
+            if (!saved)
+                qWarning() << qPrintable(errorMsg);
+            bus.send(saved ? reply.createReply() : reply.createErrorReply(QDBusError::Failed, errorMsg));
+        });
     }
 }
 
@@ -508,81 +780,283 @@ void DSGConfigServer::addConnWatchedService(const ConnServiceName & service)
     if (!calledFromDBus()) {
         return;
     }
+    // the service is watched when its credential is cached.
+    if (!m_credentialCache.credential(connection(), service))
+        watchService(connection(), service, nullptr);
+}
+
+/*
+  \internal
+
+    \breaf 监控服务的退出，退出时释放服务引用的资源并移除缓存的凭证
+*/
+void DSGConfigServer::watchService(const QDBusConnection &connection, const ConnServiceName &service,
+                                   const ServiceCredential *credential)
+{
     if (!m_watcher) {
         m_watcher = new QDBusServiceWatcher(this);
-        m_watcher->setConnection(connection());
+        m_watcher->setConnection(connection);
         m_watcher->setWatchMode(QDBusServiceWatcher::WatchForUnregistration);
         connect(m_watcher, &QDBusServiceWatcher::serviceUnregistered, [this](const QString &service){
 
             qCInfo(cfLog, "Remove watchered service:%s", qPrintable(service));
             m_watcher->removeWatchedService(service);
+            m_credentialCache.remove(service);
             m_refManager->releaseService(service);
         });
     }
     if (!m_watcher->watchedServices().contains(service)) {
         qCInfo(cfLog, "Add watchered service:%s, application:%s, user:%s.",
                 qPrintable(service),
-                qPrintable(getProcessNameByPid(connection().interface()->servicePid(service).value())),
-                qPrintable(getUserNameByUid(connection().interface()->serviceUid(service).value())));
+                qPrintable(credential ? credential->processName : QString()),
+                qPrintable(credential ? getUserNameByUid(credential->uid) : QString()));
         m_watcher->addWatchedService(service);
     }
 }
 
+/*!
+ \brief 立即保存所有未保存的缓存并合并所有日志，保存完成后回复，用于会话结束时
+ */
+void DSGConfigServer::flushAll()
+{
+    qCInfo(cfLog) << "Flush all the caches, pending requests:" << m_syncRequestCache->requestsCount();
+
+    // a running compaction doesn't contain the later records, the resource compacts them again after it,
+    // finish after the caches submitted before and all the compactions are saved.
+    struct FlushState {
+        int pending = 1;
+        bool saved = true;
+        std::function<void(bool saved)> finished;
+    };
+    auto state = std::make_shared<FlushState>();
+    const auto done = [state](bool saved) {
+        state->saved = state->saved && saved;
+        if (--state->pending == 0 && state->finished)
+            state->finished(state->saved);
+    };
+    const bool fromDBus = calledFromDBus();
+    if (fromDBus) {
+        setDelayedReply(true);
+        state->finished = [reply = message(), bus = connection()](bool saved) {
+            const QString errorMsg("Can't save all the caches.");
+            if (!saved)
+                qWarning() << qPrintable(errorMsg);
+            bus.send(saved ? reply.createReply() : reply.createErrorReply(QDBusError::Failed, errorMsg));
+        };
+    }
+
+    m_persister->beginBatch();
+    m_syncRequestCache->flush();
+    for (auto resource : std::as_const(m_resources)) {
+        ++state->pending;
+        resource->compactJournal(done);
+    }
+    // the persister saves in order, it's called back after the caches submitted before are saved.
+    m_persister->submit({}, m_localPrefix, done);
+    m_persister->endBatch();
+    if (fromDBus)
+        return;
+
+    // the follow-up compactions are submitted in the callbacks of the running ones.
+    QElapsedTimer timer;
+    timer.start();
+    do {
+        if (!m_persister->waitForDone(static_cast<int>(qMax<qint64>(0, PersistTimeout - timer.elapsed()))))
+            break;
+        QCoreApplication::sendPostedEvents(QCoreApplication::instance(), QEvent::MetaCall);
+    } while (state->pending > 0 && m_persister->pendingCount() > 0);
+}
+
 /*!
  * \brief Reload configuration files by detecting changes and updating them
  *
  */
 void DSGConfigServer::reload()
 {
-    qCInfo(cfLog()) << "Reload configuration files";
-    
-    const auto lastSignatures = m_fileSignatures;
-    m_fileSignatures = allConfigureFileSignatures(m_localPrefix);
-
-    // Find changed files
-    auto diffConfigureFiles = [] (const QVector<FileSignature> &s1, const QVector<FileSignature> &s2) {
-        QStringList diffs;
-        for (const auto& item : std::as_const(s1)) {
-            auto iter = std::find_if(s2.cbegin(), s2.cend(), [&item](const FileSignature& other) {
-                return item.filePath == other.filePath;
-            });
-            if (iter == s2.end() || (iter->changeTime != item.changeTime || iter->size != item.size)) {
-                diffs << item.filePath;
-            }
-        }
-        return diffs;
-    };
+    if (!isInitialized()) {
+        qCInfo(cfLog()) << "Reload is queued until initialization is completed";
+        m_reloadPending = true;
+        return;
+    }
+
+    if (m_fileWatcher && m_fileWatcher->isActive()) {
+        qCInfo(cfLog()) << "Reload configuration files changed since the last notification";
+        m_fileWatcher->flush();
+    } else {
+        // without the watcher, the files rewritten in place don't change the directory's modified time.
+        rescan(false);
+    }
+    // the meta database may be compiled again before reloading.
+    refreshMetaDatabase();
+}
 
-    QStringList changedFiles;
-    changedFiles << diffConfigureFiles(lastSignatures, m_fileSignatures);
-    changedFiles << diffConfigureFiles(m_fileSignatures, lastSignatures);
+/*!
+ \brief 重新扫描配置目录，与上次扫描的结果比较后更新变化的文件
+ \a prune 为true时跳过修改时间未变化的目录
+ */
+void DSGConfigServer::rescan(bool prune)
+{
+    if (!isInitialized()) {
+        m_reloadPending = true;
+        return;
+    }
 
-    changedFiles.removeDuplicates();
+    qCInfo(cfLog()) << "Reload configuration files";
 
+    const auto &changedFiles = m_fileSignatures.scan(configureDirectories(m_localPrefix), prune);
     if (changedFiles.isEmpty()) {
         qCInfo(cfLog()) << "Reload completed, no files changed";
         return;
     }
+    rebuildCatalog();
+    saveSignatures();
+    closeMetaDatabase();
 
     // Process changed files
-    int failedCount = 0;
-    for (const auto &file : std::as_const(changedFiles)) {
-        const auto errorMsg = updateInternal(file);
-        if (errorMsg) {
-            qCWarning(cfLog()) << "Reload failed to update file:" << file << ", reason:" << *errorMsg;
-            ++failedCount;
-        }
+    for (const auto &file : changedFiles) {
+        updateInternal(file, [file](const std::optional<QString> &errorMsg) {
+            if (errorMsg)
+                qCWarning(cfLog()) << "Reload failed to update file:" << file << ", reason:" << *errorMsg;
+        });
     }
 
-    qCInfo(cfLog()) << "Reload completed, processed" << changedFiles.size() << "files,"
-                    << failedCount << "failed";
+    qCInfo(cfLog()) << "Reload completed, updating" << changedFiles.size() << "files";
 }
 
-// Get all configuration file signatures
-QVector<DSGConfigServer::FileSignature> DSGConfigServer::allConfigureFileSignatures(const QString &localPrefix)
+// 编译的描述文件数据库，由软件包安装后的触发器生成
+QString DSGConfigServer::metaDatabasePath(const QString &localPrefix)
 {
-    QVector<DSGConfigServer::FileSignature> signatures;
+    return QString("%1/var/cache/dde-dconfig-daemon/meta.db").arg(localPrefix);
+}
 
+/*!
+ \brief 编译描述文件数据库
+ \a path 数据库文件，为空时使用默认路径
+ */
+bool DSGConfigServer::compileMetaDatabase(const QString &path, const QString &localPrefix)
+{
+    return DSGConfigMetaDatabase::compile(path.isEmpty() ? metaDatabasePath(localPrefix) : path,
+                                          localPrefix, configureDirectories(localPrefix));
+}
+
+/*
+  \internal
+
+    \breaf 重新打开描述文件数据库，与当前的配置文件不一致时不使用
+*/
+void DSGConfigServer::refreshMetaDatabase()
+{
+    if (m_metaDatabase.open(metaDatabasePath(m_localPrefix)) && !m_metaDatabase.isUpToDate(m_fileSignatures))
+        m_metaDatabase.close();
+
+    qCInfo(cfLog()) << "Refreshed the meta database, configurations:" << m_metaDatabase.size();
+}
+
+// 配置文件已变化，数据库需要重新编译
+void DSGConfigServer::closeMetaDatabase()
+{
+    if (!m_metaDatabase.isOpen())
+        return;
+
+    qCInfo(cfLog()) << "Configuration files changed, stop using the meta database.";
+    m_metaDatabase.close();
+}
+
+void DSGConfigServer::saveSignatures()
+{
+    const auto &indexPath = signatureIndexPath();
+    if (!indexPath.isEmpty())
+        m_fileSignatures.save(indexPath);
+}
+
+/*!
+ \brief 启用配置目录监控，文件变化后自动更新，reload只处理监控到的变化
+ inotify不可用时仍使用扫描的方式
+ */
+void DSGConfigServer::setFileWatchEnabled(const bool enable)
+{
+    if (!enable) {
+        delete m_fileWatcher;
+        m_fileWatcher = nullptr;
+        return;
+    }
+
+    if (!m_fileWatcher) {
+        m_fileWatcher = new DSGConfigWatcher(this);
+        connect(m_fileWatcher, &DSGConfigWatcher::filesChanged, this, &DSGConfigServer::onConfigureFilesChanged);
+        // events may be lost, so all directories are read again.
+        connect(m_fileWatcher, &DSGConfigWatcher::rescanRequired, this, [this]() {
+            rescan(false);
+        });
+    }
+    if (!m_fileWatcher->start(configureDirectories(m_localPrefix))) {
+        qCWarning(cfLog()) << "Can't watch configuration directories, fallback to rescan when reloading.";
+        delete m_fileWatcher;
+        m_fileWatcher = nullptr;
+    }
+}
+
+void DSGConfigServer::onConfigureFilesChanged(const QStringList &paths)
+{
+    if (!isInitialized()) {
+        m_pendingChangedFiles << paths;
+        return;
+    }
+
+    const auto &metaDirs = DConfigMeta::genericMetaDirs(m_localPrefix);
+    for (const auto &path : paths) {
+        m_fileSignatures.update(path);
+        const bool exists = m_fileSignatures.contains(path);
+        m_catalog.update(metaDirs, path, exists);
+
+        updateInternal(path, [path](const std::optional<QString> &errorMsg) {
+            if (errorMsg)
+                qCWarning(cfLog()) << "Failed to update the watched file:" << path << ", reason:" << *errorMsg;
+        });
+    }
+    saveSignatures();
+    closeMetaDatabase();
+    qCInfo(cfLog()) << "Updating watched files, count:" << paths.size();
+}
+
+void DSGConfigServer::rebuildCatalog()
+{
+    m_catalog.rebuild(DConfigMeta::genericMetaDirs(m_localPrefix), m_fileSignatures.filePaths());
+}
+
+/*!
+ \brief 返回存在描述文件的所有应用
+ */
+QStringList DSGConfigServer::listApps()
+{
+    waitForInitialized();
+    return m_catalog.apps();
+}
+
+/*!
+ \brief 返回应用目录下的所有配置
+ \a appid 应用的唯一ID，为空时返回公共配置
+ */
+QStringList DSGConfigServer::listResources(const QString &appid)
+{
+    waitForInitialized();
+    return m_catalog.resources(appid);
+}
+
+/*!
+ \brief 返回配置的所有子目录
+ \a appid 应用的唯一ID，为空时为公共配置
+ \a resource 配置文件名
+ */
+QStringList DSGConfigServer::listSubpaths(const QString &appid, const QString &resource)
+{
+    waitForInitialized();
+    return m_catalog.subpaths(appid, resource);
+}
+
+// Get meta and override directories
+QStringList DSGConfigServer::configureDirectories(const QString &localPrefix)
+{
     QStringList dirs;
     // Get generic configuration directories
     const QStringList metaDirs = DConfigMeta::genericMetaDirs(localPrefix);
@@ -596,28 +1070,5 @@ QVector<DSGConfigServer::FileSignature> DSGConfigServer::allConfigureFileSignatu
         overrideDirs << QString("%1/overrides").arg(dir);
     }
     dirs << overrideDirs;
-
-    for (const QString &dir : std::as_const(dirs)) {
-        if (!QDir(dir).exists())
-            continue;
-
-        QDirIterator iterator(dir, QStringList() << "*.json",
-                             QDir::Files | QDir::Readable, QDirIterator::Subdirectories);
-        while (iterator.hasNext()) {
-            iterator.next();
-            const QString filePath = iterator.fileInfo().absoluteFilePath();
-            
-            QFileInfo fileInfo(filePath);
-            if (fileInfo.exists()) {
-                DSGConfigServer::FileSignature signature;
-                signature.filePath = filePath;
-                signature.size = fileInfo.size();
-                signature.changeTime = fileInfo.metadataChangeTime(QTimeZone::UTC);
-
-                signatures << signature;
-            }
-        }
-    }
-
-    return signatures;
+    return dirs;
 }
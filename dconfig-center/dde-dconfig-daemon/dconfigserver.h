@@ -5,16 +5,39 @@
 #pragma once
 
 #include "dconfig_global.h"
+#include <dtkcore_global.h>
+#include "dconfigcredentials.h"
+#include "dbustypes.h"
+#include "dconfigcatalog.h"
+#include "dconfigsignatureindex.h"
+#include "dconfigpathtrie.h"
+#include "dconfigmetadatabase.h"
 #include <optional>
+#include <memory>
+#include <functional>
 #include <QObject>
+#include <QPointer>
+#include <QElapsedTimer>
 #include <QDBusObjectPath>
 #include <QDBusContext>
 #include <QDBusServiceWatcher>
 
+DCORE_BEGIN_NAMESPACE
+class DConfigFile;
+DCORE_END_NAMESPACE
+
+DCORE_USE_NAMESPACE
+
 class DSGConfigResource;
+class DSGConfigConn;
 class RefManager;
 class ConfigSyncBatchRequest;
 class ConfigSyncRequestCache;
+class DSGConfigConnDispatcher;
+class DSGConfigWatcher;
+class DSGConfigPersister;
+class QThread;
+class QThreadPool;
 /**
  * @brief The DSGConfigServer class
  * 管理配置策略服务
@@ -33,6 +56,8 @@ public:
     bool registerService();
     
     void initialize();
+    bool isInitialized() const;
+    void waitForInitialized();
 
     DSGConfigResource* resourceObject(const GenericResourceKey &key) const;
 
@@ -42,6 +67,10 @@ public:
 
     int resourceSize() const;
 
+    void setFileWatchEnabled(const bool enable);
+
+    static bool compileMetaDatabase(const QString &path, const QString &localPrefix);
+
 Q_SIGNALS:
     void releaseResource(const ConnKey& resource);
 
@@ -52,6 +81,8 @@ public Q_SLOTS:
 
     QDBusObjectPath acquireManagerV2(const uint &uid, const QString &appid, const QString &name, const QString &subpath);
 
+    QList<QDBusObjectPath> acquireManagers(const uint &uid, const ConfigResourceIdList &resources);
+
     void update(const QString &path);
 
     void sync(const QString &path);
@@ -65,8 +96,14 @@ public Q_SLOTS:
 
     void removeUserData(const uint &uid);
 
+    void flushAll();
+
     void reload();
 
+    QStringList listApps();
+    QStringList listResources(const QString &appid);
+    QStringList listSubpaths(const QString &appid, const QString &resource);
+
 private Q_SLOTS:
     void onReleaseChanged(const ConnServiceName &service, const ConnKey &connKey);
 
@@ -78,22 +115,57 @@ private Q_SLOTS:
 
     void doSyncConfigCache(const ConfigSyncBatchRequest &request);
 
+    void onConfigureFilesChanged(const QStringList &paths);
+
+    void rescan(bool prune);
+
+    void onInitialized();
+
 private:
-    ResourceKey getResourceKeyByConfigCache(const ConfigCacheKey &key);
+    DSGConfigConn *acquireConn(const ConnServiceName &service, const uint uid, const QString &appid,
+                               const QString &name, const QString &subpath, QString &errorMsg);
 
-    ConfigureId getConfigureIdByPath(const QString &path);
+    void watchService(const QDBusConnection &connection, const ConnServiceName &service,
+                      const ServiceCredential *credential);
 
-    bool isConfigurePath(const QString &path, const QString& appId) const;
+    ResourceKey getResourceKeyByConfigCache(const ConfigCacheKey &key);
 
-    std::optional<QString> updateInternal(const QString &path);
+    ConfigureId getConfigureIdByPath(const QString &path);
 
-    // Reload interface related structures and methods
-    struct FileSignature {
-        qint64 size;
-        QDateTime changeTime;
-        QString filePath;
+    bool isConfigurePath(const QString &path) const;
+
+    using UpdateCallback = std::function<void(const std::optional<QString> &errorMsg)>;
+    void updateInternal(const QString &path, const UpdateCallback &callback);
+    // 线程池中重新解析的描述文件，完成后在主线程中替换
+    struct ReparseJob {
+        QString path;
+        GenericResourceKey resourceKey;
+        QPointer<DSGConfigResource> resource;
+        QString appid;
+        quint64 generation = 0;
+        std::unique_ptr<DConfigFile> config;
+        bool loaded = false;
+        UpdateCallback callback;
+    };
+    void onReparsed(const std::shared_ptr<ReparseJob> &job);
+
+    // Reload interface related methods
+    static QStringList configureDirectories(const QString &localPrefix);
+    void rebuildCatalog();
+    void saveSignatures();
+    static QString metaDatabasePath(const QString &localPrefix);
+    void refreshMetaDatabase();
+    void closeMetaDatabase();
+
+    // 工作线程中初始化的结果，线程结束后在主线程中使用
+    struct InitializeResult {
+        DSGConfigSignatureIndex signatures;
+        DSGConfigCatalog catalog;
+        DSGConfigMetaDatabase metaDatabase;
+        bool loaded = false;
+        int changedCount = 0;
+        qint64 elapsed = 0;
     };
-    static QVector<FileSignature> allConfigureFileSignatures(const QString &localPrefix);
 
 private:
 
@@ -107,7 +179,38 @@ private:
     QString m_localPrefix;
     bool m_enableExit = false;
     ConfigSyncRequestCache *m_syncRequestCache = nullptr;
+    // 所有连接共用的D-Bus对象，注册服务时创建
+    DSGConfigConnDispatcher *m_connDispatcher = nullptr;
+
+    // 调用者凭证缓存，服务退出时移除
+    ServiceCredentialCache m_credentialCache;
 
     // Last time of the configuration file signature
-    QVector<FileSignature> m_fileSignatures;
+    DSGConfigSignatureIndex m_fileSignatures;
+    // 描述文件目录，随文件签名一同更新
+    DSGConfigCatalog m_catalog;
+    // 编译的描述文件数据库，配置文件变化后关闭
+    DSGConfigMetaDatabase m_metaDatabase;
+    // 描述文件及override目录，用于判断更新的文件是否为配置文件
+    mutable DSGConfigPathTrie m_configureRoots;
+    mutable QString m_configureRootsPrefix;
+    mutable QByteArray m_configureRootsDataDirs;
+    // 配置目录监控，未启用时reload扫描所有目录
+    DSGConfigWatcher *m_fileWatcher = nullptr;
+
+    // 启动阶段，初始化完成前的reload及文件变化暂存
+    QElapsedTimer m_startupTimer;
+    bool m_firstRequestServed = false;
+    QThread *m_initializeThread = nullptr;
+    std::shared_ptr<InitializeResult> m_initializeResult;
+    bool m_initialized = false;
+    bool m_reloadPending = false;
+    QStringList m_pendingChangedFiles;
+
+    // 重新解析描述文件的线程池，及每个资源最后一次更新的序号
+    QThreadPool *m_reparsePool = nullptr;
+    QHash<ResourceKey, quint64> m_reparseGenerations;
+
+    // 保存缓存的持久化线程
+    DSGConfigPersister *m_persister = nullptr;
 };
@@ -0,0 +1,225 @@
+// SPDX-FileCopyrightText: 2026 Uniontech Software Technology Co.,Ltd.
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#include "dconfigsignatureindex.h"
+#include "dconfig_global.h"
+
+#include <QDataStream>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+
+static constexpr quint32 IndexMagic = 0x44435349; // "DCSI"
+static constexpr quint32 IndexVersion = 1;
+
+/*!
+ \brief 扫描配置目录，更新签名并返回新增、删除或修改的文件
+ \a roots 需要扫描的目录，包括子目录
+ \a prune 为true时，修改时间未变化的目录沿用上次的文件列表及文件签名，
+    只能检测到通过新增、删除或重命名方式修改的文件，原地修改的文件由监控或update处理
+ \return 变化的文件
+ */
+QStringList DSGConfigSignatureIndex::scan(const QStringList &roots, bool prune)
+{
+    FileSignatures files;
+    files.reserve(m_files.size());
+    DirectorySignatures dirs;
+    dirs.reserve(m_dirs.size());
+    for (const auto &root : roots) {
+        const auto &dir = QDir::cleanPath(root);
+        if (QFileInfo(dir).isDir())
+            scanDirectory(dir, prune, files, dirs);
+    }
+
+    QStringList changedFiles;
+    for (auto iter = files.cbegin(); iter != files.cend(); ++iter) {
+        auto old = m_files.constFind(iter.key());
+        if (old == m_files.constEnd() || old.value() != iter.value())
+            changedFiles << iter.key();
+    }
+    for (auto iter = m_files.cbegin(); iter != m_files.cend(); ++iter) {
+        if (!files.contains(iter.key()))
+            changedFiles << iter.key();
+    }
+
+    m_files.swap(files);
+    m_dirs.swap(dirs);
+    return changedFiles;
+}
+
+/*!
+ \brief 更新单个文件的签名，目录的修改时间不更新，下次扫描时仍读取此目录
+ \return 签名是否变化
+ */
+bool DSGConfigSignatureIndex::update(const QString &filePath)
+{
+    const auto &path = QDir::cleanPath(filePath);
+    const auto &dir = QFileInfo(path).path();
+    auto directory = m_dirs.find(dir);
+    const auto &signature = fileSignature(path);
+    if (signature.size < 0) {
+        if (directory != m_dirs.end())
+            directory->files.removeOne(path);
+        return m_files.remove(path) > 0;
+    }
+
+    if (directory != m_dirs.end() && !directory->files.contains(path))
+        directory->files << path;
+
+    auto iter = m_files.find(path);
+    if (iter != m_files.end() && iter.value() == signature)
+        return false;
+
+    m_files.insert(path, signature);
+    return true;
+}
+
+void DSGConfigSignatureIndex::clear()
+{
+    m_files.clear();
+    m_dirs.clear();
+}
+
+QStringList DSGConfigSignatureIndex::filePaths() const
+{
+    return m_files.keys();
+}
+
+bool DSGConfigSignatureIndex::contains(const QString &filePath) const
+{
+    return m_files.contains(QDir::cleanPath(filePath));
+}
+
+int DSGConfigSignatureIndex::size() const
+{
+    return m_files.size();
+}
+
+/*!
+ \brief 从文件中加载上次保存的签名
+ \return 文件不存在或格式不匹配时返回false
+ */
+bool DSGConfigSignatureIndex::load(const QString &path)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly))
+        return false;
+
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_5_11);
+    quint32 magic = 0, version = 0;
+    stream >> magic >> version;
+    if (magic != IndexMagic || version != IndexVersion)
+        return false;
+
+    FileSignatures files;
+    DirectorySignatures dirs;
+    quint32 count = 0;
+    stream >> count;
+    files.reserve(static_cast<int>(count));
+    for (quint32 i = 0; i < count && stream.status() == QDataStream::Ok; ++i) {
+        QString filePath;
+        FileSignature signature;
+        stream >> filePath >> signature.size >> signature.changeTime;
+        files.insert(filePath, signature);
+    }
+    stream >> count;
+    dirs.reserve(static_cast<int>(count));
+    for (quint32 i = 0; i < count && stream.status() == QDataStream::Ok; ++i) {
+        QString dir;
+        DirectorySignature signature;
+        stream >> dir >> signature.modifyTime >> signature.files >> signature.subdirs;
+        dirs.insert(dir, signature);
+    }
+    if (stream.status() != QDataStream::Ok) {
+        qCWarning(cfLog) << "The signature index is corrupted:" << path;
+        return false;
+    }
+
+    m_files.swap(files);
+    m_dirs.swap(dirs);
+    return true;
+}
+
+bool DSGConfigSignatureIndex::save(const QString &path) const
+{
+    if (!QDir().mkpath(QFileInfo(path).path()))
+        return false;
+
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qCWarning(cfLog) << "Can't save the signature index:" << path << file.errorString();
+        return false;
+    }
+
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_5_11);
+    stream << IndexMagic << IndexVersion;
+    stream << static_cast<quint32>(m_files.size());
+    for (auto iter = m_files.cbegin(); iter != m_files.cend(); ++iter)
+        stream << iter.key() << iter.value().size << iter.value().changeTime;
+    stream << static_cast<quint32>(m_dirs.size());
+    for (auto iter = m_dirs.cbegin(); iter != m_dirs.cend(); ++iter)
+        stream << iter.key() << iter.value().modifyTime << iter.value().files << iter.value().subdirs;
+
+    return file.commit();
+}
+
+void DSGConfigSignatureIndex::scanDirectory(const QString &dir, bool prune, FileSignatures &files, DirectorySignatures &dirs) const
+{
+    // override directories are also in the meta directories.
+    if (dirs.contains(dir))
+        return;
+
+    const QFileInfo info(dir);
+    if (!info.isDir())
+        return;
+
+    const qint64 modifyTime = info.lastModified().toMSecsSinceEpoch();
+    auto old = m_dirs.constFind(dir);
+    if (prune && old != m_dirs.constEnd() && old->modifyTime == modifyTime) {
+        dirs.insert(dir, old.value());
+        for (const auto &file : old->files) {
+            auto signature = m_files.constFind(file);
+            if (signature != m_files.constEnd()) {
+                files.insert(file, signature.value());
+            } else {
+                const auto &current = fileSignature(file);
+                if (current.size >= 0)
+                    files.insert(file, current);
+            }
+        }
+        for (const auto &subdir : old->subdirs)
+            scanDirectory(subdir, prune, files, dirs);
+        return;
+    }
+
+    DirectorySignature signature;
+    signature.modifyTime = modifyTime;
+    const QDir directory(dir);
+    const auto &fileInfos = directory.entryInfoList(QStringList() << "*.json", QDir::Files | QDir::Readable);
+    for (const auto &fileInfo : fileInfos) {
+        const auto &filePath = QDir::cleanPath(fileInfo.absoluteFilePath());
+        files.insert(filePath, FileSignature{fileInfo.size(), fileInfo.metadataChangeTime().toMSecsSinceEpoch()});
+        signature.files << filePath;
+    }
+    const auto &subdirs = directory.entryInfoList(QDir::Dirs | QDir::NoDotAndDotDot | QDir::NoSymLinks);
+    for (const auto &subdir : subdirs)
+        signature.subdirs << QDir::cleanPath(subdir.absoluteFilePath());
+
+    dirs.insert(dir, signature);
+    for (const auto &subdir : std::as_const(signature.subdirs))
+        scanDirectory(subdir, prune, files, dirs);
+}
+
+DSGConfigSignatureIndex::FileSignature DSGConfigSignatureIndex::fileSignature(const QString &filePath)
+{
+    const QFileInfo info(filePath);
+    if (!info.exists())
+        return FileSignature();
+
+    return FileSignature{info.size(), info.metadataChangeTime().toMSecsSinceEpoch()};
+}
@@ -0,0 +1,60 @@
+// SPDX-FileCopyrightText: 2026 Uniontech Software Technology Co.,Ltd.
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#pragma once
+
+#include <QHash>
+#include <QStringList>
+
+/**
+ * @brief The DSGConfigSignatureIndex class
+ * 配置目录中所有描述文件的签名（文件大小 + 变更时间），用于检测变化的文件。
+ * 同时记录每个目录的修改时间及其中的文件和子目录，目录修改时间未变化时不再读取目录及文件的状态，
+ * 可持久化到文件，服务重启后与上次的结果比较。
+ */
+class DSGConfigSignatureIndex
+{
+public:
+    struct FileSignature {
+        qint64 size = -1;
+        qint64 changeTime = 0;
+
+        bool operator==(const FileSignature &other) const
+        {
+            return size == other.size && changeTime == other.changeTime;
+        }
+        bool operator!=(const FileSignature &other) const
+        {
+            return !(*this == other);
+        }
+    };
+
+    QStringList scan(const QStringList &roots, bool prune = true);
+    bool update(const QString &filePath);
+    void clear();
+
+    QStringList filePaths() const;
+    bool contains(const QString &filePath) const;
+    int size() const;
+
+    bool load(const QString &path);
+    bool save(const QString &path) const;
+
+    static FileSignature fileSignature(const QString &filePath);
+
+private:
+    struct DirectorySignature {
+        qint64 modifyTime = 0;
+        QStringList files;
+        QStringList subdirs;
+    };
+    using FileSignatures = QHash<QString, FileSignature>;
+    using DirectorySignatures = QHash<QString, DirectorySignature>;
+
+    void scanDirectory(const QString &dir, bool prune, FileSignatures &files, DirectorySignatures &dirs) const;
+
+private:
+    FileSignatures m_files;
+    DirectorySignatures m_dirs;
+};
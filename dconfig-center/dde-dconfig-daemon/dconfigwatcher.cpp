@@ -0,0 +1,282 @@
+// SPDX-FileCopyrightText: 2026 Uniontech Software Technology Co.,Ltd.
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#include "dconfigwatcher.h"
+#include "dconfig_global.h"
+
+#include <QDir>
+#include <QDirIterator>
+#include <QFile>
+#include <QFileInfo>
+#include <QSocketNotifier>
+#include <QTimer>
+#include <QDebug>
+
+#include <sys/inotify.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+
+static constexpr uint32_t WatchMask = IN_CLOSE_WRITE | IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO
+        | IN_DELETE_SELF | IN_MOVE_SELF | IN_ONLYDIR;
+
+DSGConfigWatcher::DSGConfigWatcher(QObject *parent)
+    : QObject(parent)
+    , m_debounceTimer(new QTimer(this))
+{
+    m_debounceTimer->setSingleShot(true);
+    m_debounceTimer->setInterval(500);
+    connect(m_debounceTimer, &QTimer::timeout, this, &DSGConfigWatcher::flush);
+}
+
+DSGConfigWatcher::~DSGConfigWatcher()
+{
+    stop();
+}
+
+/*!
+ \brief 开始监控目录，不存在的目录监控其存在的上级目录，目录被创建后再监控
+ \a roots 需要监控的目录，包括子目录
+ \return inotify不可用或监控数量超出限制时返回false
+ */
+bool DSGConfigWatcher::start(const QStringList &roots)
+{
+    stop();
+
+    m_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (m_fd < 0) {
+        qCWarning(cfLog) << "Can't initialize inotify:" << strerror(errno);
+        return false;
+    }
+
+    for (const auto &root : roots)
+        m_roots << QDir::cleanPath(root);
+    m_roots.removeDuplicates();
+
+    for (const auto &root : std::as_const(m_roots))
+        watchRoot(root);
+
+    if (m_failed) {
+        stop();
+        return false;
+    }
+
+    m_notifier = new QSocketNotifier(m_fd, QSocketNotifier::Read, this);
+    connect(m_notifier, &QSocketNotifier::activated, this, &DSGConfigWatcher::onActivated);
+    qCInfo(cfLog) << "Watching configuration directories, count:" << m_watches.size();
+    return true;
+}
+
+void DSGConfigWatcher::stop()
+{
+    m_debounceTimer->stop();
+    if (m_notifier) {
+        delete m_notifier;
+        m_notifier = nullptr;
+    }
+    if (m_fd >= 0) {
+        close(m_fd);
+        m_fd = -1;
+    }
+    m_roots.clear();
+    m_watches.clear();
+    m_watchedDirs.clear();
+    m_pendingPaths.clear();
+    m_rescanRequired = false;
+    m_failed = false;
+}
+
+bool DSGConfigWatcher::isActive() const
+{
+    return m_fd >= 0;
+}
+
+/*!
+ \brief 设置合并文件变化的时间
+ \a ms 毫秒
+ */
+void DSGConfigWatcher::setDebounceTime(const int ms)
+{
+    m_debounceTimer->setInterval(ms);
+}
+
+int DSGConfigWatcher::debounceTime() const
+{
+    return m_debounceTimer->interval();
+}
+
+/*!
+ \brief 立即处理已收到的事件并通知，不再等待合并
+ */
+void DSGConfigWatcher::flush()
+{
+    if (isActive())
+        onActivated();
+
+    m_debounceTimer->stop();
+    if (m_rescanRequired) {
+        m_rescanRequired = false;
+        m_pendingPaths.clear();
+        Q_EMIT rescanRequired();
+        return;
+    }
+    if (m_pendingPaths.isEmpty())
+        return;
+
+    QStringList paths = m_pendingPaths.values();
+    m_pendingPaths.clear();
+    paths.sort();
+    Q_EMIT filesChanged(paths);
+}
+
+void DSGConfigWatcher::onActivated()
+{
+    alignas(struct inotify_event) char buffer[4096];
+    bool hasEvents = false;
+    while (true) {
+        const auto size = read(m_fd, buffer, sizeof(buffer));
+        if (size <= 0)
+            break;
+
+        for (char *ptr = buffer; ptr < buffer + size; ) {
+            const auto event = reinterpret_cast<const struct inotify_event *>(ptr);
+            ptr += sizeof(struct inotify_event) + event->len;
+            hasEvents = true;
+
+            if (event->mask & IN_Q_OVERFLOW) {
+                qCWarning(cfLog) << "Inotify event queue overflowed, rescan is required.";
+                m_rescanRequired = true;
+                continue;
+            }
+
+            const auto dir = m_watches.value(event->wd);
+            if (event->mask & IN_IGNORED) {
+                m_watches.remove(event->wd);
+                m_watchedDirs.remove(dir);
+                // the root or its ancestor is removed, watch the existing ancestor to wait it's created again.
+                for (const auto &root : std::as_const(m_roots)) {
+                    if (root == dir || root.startsWith(dir + '/'))
+                        watchRoot(root);
+                }
+                continue;
+            }
+            if (dir.isEmpty() || event->len == 0)
+                continue;
+
+            const QString path = dir + '/' + QFile::decodeName(event->name);
+            if (event->mask & IN_ISDIR) {
+                if (event->mask & (IN_CREATE | IN_MOVED_TO)) {
+                    onDirectoryAdded(path);
+                } else if ((event->mask & IN_MOVED_FROM) && isInRoots(path)) {
+                    // files in the moved directory aren't notified.
+                    m_rescanRequired = true;
+                }
+                continue;
+            }
+
+            if (isInRoots(path))
+                addPendingPath(path);
+        }
+    }
+
+    if (m_failed) {
+        qCWarning(cfLog) << "Stop watching configuration directories, rescan is required.";
+        stop();
+        Q_EMIT rescanRequired();
+        return;
+    }
+
+    if (hasEvents && (m_rescanRequired || !m_pendingPaths.isEmpty()) && !m_debounceTimer->isActive())
+        m_debounceTimer->start();
+}
+
+void DSGConfigWatcher::watchRoot(const QString &root)
+{
+    QString dir = root;
+    while (!QFileInfo(dir).isDir()) {
+        const auto parent = QFileInfo(dir).path();
+        if (parent == dir)
+            return;
+        dir = parent;
+    }
+
+    if (dir == root) {
+        watchTree(root);
+    } else {
+        addWatch(dir);
+    }
+}
+
+void DSGConfigWatcher::watchTree(const QString &dir)
+{
+    addWatch(dir);
+    QDirIterator iterator(dir, QDir::Dirs | QDir::NoDotAndDotDot, QDirIterator::Subdirectories);
+    while (iterator.hasNext()) {
+        iterator.next();
+        addWatch(iterator.filePath());
+    }
+}
+
+int DSGConfigWatcher::addWatch(const QString &dir)
+{
+    const auto &path = QDir::cleanPath(dir);
+    auto iter = m_watchedDirs.constFind(path);
+    if (iter != m_watchedDirs.constEnd())
+        return iter.value();
+
+    const int wd = inotify_add_watch(m_fd, QFile::encodeName(path).constData(), WatchMask);
+    if (wd < 0) {
+        qCWarning(cfLog) << "Can't watch the directory:" << path << strerror(errno);
+        if (errno == ENOSPC || errno == ENOMEM)
+            m_failed = true;
+        return wd;
+    }
+    m_watches.insert(wd, path);
+    m_watchedDirs.insert(path, wd);
+    return wd;
+}
+
+/*
+  \internal
+
+    \breaf 新增的目录中可能已经存在文件，监控目录后将其中的文件作为变化的文件
+*/
+void DSGConfigWatcher::onDirectoryAdded(const QString &dir)
+{
+    if (isInRoots(dir)) {
+        watchTree(dir);
+        QDirIterator iterator(dir, QStringList() << "*.json", QDir::Files, QDirIterator::Subdirectories);
+        while (iterator.hasNext()) {
+            iterator.next();
+            addPendingPath(iterator.filePath());
+        }
+        return;
+    }
+
+    for (const auto &root : std::as_const(m_roots)) {
+        if (!root.startsWith(dir + '/'))
+            continue;
+
+        if (QFileInfo(root).isDir()) {
+            onDirectoryAdded(root);
+        } else {
+            watchRoot(root);
+        }
+    }
+}
+
+bool DSGConfigWatcher::isInRoots(const QString &path) const
+{
+    for (const auto &root : m_roots) {
+        if (path == root || path.startsWith(root + '/'))
+            return true;
+    }
+    return false;
+}
+
+void DSGConfigWatcher::addPendingPath(const QString &path)
+{
+    if (path.endsWith(QLatin1String(".json")))
+        m_pendingPaths.insert(QDir::cleanPath(path));
+}
@@ -0,0 +1,61 @@
+// SPDX-FileCopyrightText: 2026 Uniontech Software Technology Co.,Ltd.
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#pragma once
+
+#include <QObject>
+#include <QHash>
+#include <QSet>
+#include <QStringList>
+
+class QSocketNotifier;
+class QTimer;
+/**
+ * @brief The DSGConfigWatcher class
+ * 通过inotify监控描述文件及override目录，合并一段时间内变化的配置文件后通知，
+ * 事件队列溢出或目录被移走时无法确定变化的文件，通知需要重新扫描。
+ */
+class DSGConfigWatcher : public QObject
+{
+    Q_OBJECT
+public:
+    explicit DSGConfigWatcher(QObject *parent = nullptr);
+    virtual ~DSGConfigWatcher() override;
+
+    bool start(const QStringList &roots);
+    void stop();
+    bool isActive() const;
+
+    void setDebounceTime(const int ms);
+    int debounceTime() const;
+
+    void flush();
+
+Q_SIGNALS:
+    void filesChanged(const QStringList &paths);
+    void rescanRequired();
+
+private Q_SLOTS:
+    void onActivated();
+
+private:
+    void watchRoot(const QString &root);
+    void watchTree(const QString &dir);
+    int addWatch(const QString &dir);
+    void onDirectoryAdded(const QString &dir);
+    bool isInRoots(const QString &path) const;
+    void addPendingPath(const QString &path);
+
+private:
+    int m_fd = -1;
+    QSocketNotifier *m_notifier = nullptr;
+    QTimer *m_debounceTimer = nullptr;
+    QStringList m_roots;
+    QHash<int, QString> m_watches;
+    QHash<QString, int> m_watchedDirs;
+    QSet<QString> m_pendingPaths;
+    bool m_rescanRequired = false;
+    // 监控数量超出限制，无法继续监控
+    bool m_failed = false;
+};
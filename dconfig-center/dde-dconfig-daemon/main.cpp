@@ -4,6 +4,7 @@
 
 #include <QCoreApplication>
 #include <QCommandLineParser>
+#include <QElapsedTimer>
 #include <QDebug>
 #include <DLog>
 
@@ -18,6 +19,9 @@ static void exitApp(int signal)
 }
 int main(int argc, char *argv[])
 {
+    QElapsedTimer startupTimer;
+    startupTimer.start();
+
     // 异常处理，调用QCoreApplication::exit，使DSGConfigServer正常析构。
     struct sigaction sa;
     sa.sa_handler = exitApp;
@@ -43,8 +47,20 @@ int main(int argc, char *argv[])
     QCommandLineOption exitOption("e", QCoreApplication::translate("main", "exit application when all resource released."), "exit", QString::number(true));
     parser.addOption(exitOption);
 
+    QCommandLineOption watchOption("w", QCoreApplication::translate("main", "watch configuration directories and update changed files automatically."));
+    parser.addOption(watchOption);
+
+    QCommandLineOption compileOption("c", QCoreApplication::translate("main", "compile the meta database to the path and exit."), "path");
+    parser.addOption(compileOption);
+
     parser.process(a);
 
+    // Run by the package trigger, it doesn't register the service.
+    if (parser.isSet(compileOption)) {
+        const bool compiled = DSGConfigServer::compileMetaDatabase(parser.value(compileOption), parser.value(localPrefixOption));
+        return compiled ? 0 : 1;
+    }
+
     DSGConfigServer dsgConfig;
 
     if (parser.isSet(delayTimeOption)) {
@@ -60,7 +76,7 @@ int main(int argc, char *argv[])
     }
 
     if (dsgConfig.registerService()) {
-        qInfo() << "Starting dconfig daemon succeeded.";
+        qInfo() << "Starting dconfig daemon succeeded, elapsed:" << startupTimer.elapsed() << "ms";
     } else {
         qInfo() << "Starting dconfig daemon failed.";
         return 1;
@@ -68,26 +84,38 @@ int main(int argc, char *argv[])
 
     // Initialization of DtkCore needs to be later than `registerService` avoid earlier request itself.
     Dtk::Core::DLogManager::registerConsoleAppender();
-    const char *logsDirectory("LOGS_DIRECTORY");
-    if (!qEnvironmentVariableIsEmpty(logsDirectory)) {
-        const QString path(qEnvironmentVariable(logsDirectory));
-        const auto logPath(QString("%1/%2/%2.log").arg(path).arg(a.applicationName()));
-        const QFileInfo file(logPath);
-        if (!file.exists()) {
-            if (!QDir().mkpath(file.absoluteDir().path())) {
-                qWarning() << "Failed to create log path." << file.absoluteFilePath();
-            }
-        }
-        Dtk::Core::DLogManager::setlogFilePath(logPath);
-    }
-    Dtk::Core::DLogManager::registerFileAppender();
-    qInfo() << "Log path is:" << Dtk::Core::DLogManager::getlogFilePath();
     QObject::connect(qApp, &QCoreApplication::aboutToQuit, [&dsgConfig]() {
         qInfo() << "Exit dconfig daemon and release resources.";
         dsgConfig.exit();
     });
 
+    // Watch before initializing signatures so that changes between them aren't missed.
+    if (parser.isSet(watchOption)) {
+        dsgConfig.setFileWatchEnabled(true);
+    }
+
+    // Scan configuration files in a worker thread, requests are served meanwhile.
     dsgConfig.initialize(); // Initialize dconfig daemon
 
+    // Setting up the log file isn't needed by requests, do it after the pending requests in the event loop.
+    QMetaObject::invokeMethod(&a, [&a, &startupTimer]() {
+        const char *logsDirectory("LOGS_DIRECTORY");
+        if (!qEnvironmentVariableIsEmpty(logsDirectory)) {
+            const QString path(qEnvironmentVariable(logsDirectory));
+            const auto logPath(QString("%1/%2/%2.log").arg(path).arg(a.applicationName()));
+            const QFileInfo file(logPath);
+            if (!file.exists()) {
+                if (!QDir().mkpath(file.absoluteDir().path())) {
+                    qWarning() << "Failed to create log path." << file.absoluteFilePath();
+                }
+            }
+            Dtk::Core::DLogManager::setlogFilePath(logPath);
+        }
+        Dtk::Core::DLogManager::registerFileAppender();
+        qInfo() << "Log path is:" << Dtk::Core::DLogManager::getlogFilePath()
+                << ", elapsed since startup:" << startupTimer.elapsed() << "ms";
+    }, Qt::QueuedConnection);
+
+    qInfo() << "Entering event loop, elapsed since startup:" << startupTimer.elapsed() << "ms";
     return a.exec();
 }
@@ -6,20 +6,12 @@ if(EnableDtk5)
 qt5_add_dbus_adaptor(DCONFIG_DBUS_XML ../dde-dconfig-daemon/services/org.desktopspec.ConfigManager.xml
     dconfigserver.h DSGConfigServer
     configmanager_adaptor DSGConfigAdaptor)
-
-qt5_add_dbus_adaptor(DCONFIG_DBUS_XML ../dde-dconfig-daemon/services/org.desktopspec.ConfigManager.Manager.xml
-    dconfigconn.h DSGConfigConn
-    manager_adaptor DSGConfigManagerAdaptor)
 endif()
 
 if(EnableDtk6)
 qt_add_dbus_adaptor(DCONFIG_DBUS_XML ../dde-dconfig-daemon/services/org.desktopspec.ConfigManager.xml
     dconfigserver.h DSGConfigServer
     configmanager_adaptor DSGConfigAdaptor)
-
-qt_add_dbus_adaptor(DCONFIG_DBUS_XML ../dde-dconfig-daemon/services/org.desktopspec.ConfigManager.Manager.xml
-    dconfigconn.h DSGConfigConn
-    manager_adaptor DSGConfigManagerAdaptor)
 endif()
 
 include_directories(../common)
@@ -30,10 +22,30 @@ set(HEADERS
     ${CMAKE_CURRENT_LIST_DIR}/dconfigresource.h
     ${CMAKE_CURRENT_LIST_DIR}/dconfigconn.h
     ${CMAKE_CURRENT_LIST_DIR}/dconfigrefmanager.h
+    ${CMAKE_CURRENT_LIST_DIR}/dconfigcredentials.h
+    ${CMAKE_CURRENT_LIST_DIR}/dconfigconndispatcher.h
+    ${CMAKE_CURRENT_LIST_DIR}/dconfigcatalog.h
+    ${CMAKE_CURRENT_LIST_DIR}/dconfigwatcher.h
+    ${CMAKE_CURRENT_LIST_DIR}/dconfigsignatureindex.h
+    ${CMAKE_CURRENT_LIST_DIR}/dconfigpathtrie.h
+    ${CMAKE_CURRENT_LIST_DIR}/dconfigmetadatabase.h
+    ${CMAKE_CURRENT_LIST_DIR}/dconfigjournal.h
+    ${CMAKE_CURRENT_LIST_DIR}/dconfigpersister.h
+    ${CMAKE_CURRENT_LIST_DIR}/../common/dbustypes.h
 )
 set(SOURCES
     ${CMAKE_CURRENT_LIST_DIR}/dconfigserver.cpp
     ${CMAKE_CURRENT_LIST_DIR}/dconfigresource.cpp
     ${CMAKE_CURRENT_LIST_DIR}/dconfigconn.cpp
     ${CMAKE_CURRENT_LIST_DIR}/dconfigrefmanager.cpp
+    ${CMAKE_CURRENT_LIST_DIR}/dconfigcredentials.cpp
+    ${CMAKE_CURRENT_LIST_DIR}/dconfigconndispatcher.cpp
+    ${CMAKE_CURRENT_LIST_DIR}/dconfigcatalog.cpp
+    ${CMAKE_CURRENT_LIST_DIR}/dconfigwatcher.cpp
+    ${CMAKE_CURRENT_LIST_DIR}/dconfigsignatureindex.cpp
+    ${CMAKE_CURRENT_LIST_DIR}/dconfigpathtrie.cpp
+    ${CMAKE_CURRENT_LIST_DIR}/dconfigmetadatabase.cpp
+    ${CMAKE_CURRENT_LIST_DIR}/dconfigjournal.cpp
+    ${CMAKE_CURRENT_LIST_DIR}/dconfigpersister.cpp
+    ${CMAKE_CURRENT_LIST_DIR}/services/services.qrc
 )
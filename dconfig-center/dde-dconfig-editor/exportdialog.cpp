@@ -54,9 +54,12 @@ void ExportDialog::loadData(const QString &language)
     m_rootItems.clear();
     m_childItems.clear();
 
+    // 先创建所有资源及子路径的节点，之后批量获取配置
+    QList<QPair<DStandardItem *, ValueHandler *>> items;
     const auto &apps = applications();
     for (auto app : apps) {
-        if (resourcesForApp(app).isEmpty()) {
+        const auto &resources = resourcesForApp(app);
+        if (resources.isEmpty()) {
             continue;
         }
         DStandardItem *rootItem = new DStandardItem(app);
@@ -65,73 +68,60 @@ void ExportDialog::loadData(const QString &language)
         model->appendRow(rootItem);
         m_rootItems.append(rootItem);
 
-        const auto &resources = resourcesForApp(app);
         for (auto resource : resources) {
             auto resourceItem = new DStandardItem();
             resourceItem->setSizeHint(QSize(200, 45));
             resourceItem->setCheckable(true);
             resourceItem->setText(resource);
             rootItem->appendRow(resourceItem);
+            // 默认路径
+            items.append(qMakePair(resourceItem, new ValueHandler(app, resource, QString())));
 
-            // 添加默认路径 key-value
-            QString subpath;
-            m_getter.reset(new ValueHandler(app, resource, subpath));
-            QScopedPointer<ConfigGetter> manager(m_getter->createManager());
-            if (!manager) {
-                continue;
-            }
-            for (auto key : manager->keyList()) {
-                auto keyValueItem = new DStandardItem();
-                keyValueItem->setCheckable(true);
-
-                keyValueItem->setData(app, AppidRole);
-                keyValueItem->setData(resource, ResourceRole);
-                keyValueItem->setData(subpath, SubpathRole);
-                QVariant value =  manager.get()->value(key);
-                keyValueItem->setData(key, KeyRole);
-                keyValueItem->setData(value, ValueRole);
-                QVariant description = manager.get()->description(key, language);
-                keyValueItem->setData(description, DescriptionRole);
-                keyValueItem->setText(key + ": " + value.toString());
-
-                resourceItem->appendRow(keyValueItem);
-                m_childItems.append(keyValueItem);
-            }
-
-            // 添加子路径 key-value
             const auto &subpaths = subpathsForResource(app, resource);
             for (auto subpath : subpaths) {
                 auto subpathItem = new DStandardItem();
                 subpathItem->setCheckable(true);
                 subpathItem->setText(subpath);
                 rootItem->appendRow(subpathItem);
-
-                m_getter.reset(new ValueHandler(app, resource, subpath));
-                QScopedPointer<ConfigGetter> manager(m_getter->createManager());
-                if (!manager) {
-                    continue;
-                }
-                for (auto key : manager->keyList()) {
-                    auto keyValueItem = new DStandardItem();
-                    keyValueItem->setCheckable(true);
-
-                    keyValueItem->setData(app, AppidRole);
-                    keyValueItem->setData(resource, ResourceRole);
-                    keyValueItem->setData(subpath, SubpathRole);
-                    QVariant value =  manager.get()->value(key);
-                    keyValueItem->setData(key, KeyRole);
-                    keyValueItem->setData(value, ValueRole);
-                    QVariant description = manager.get()->description(key, language);
-                    keyValueItem->setData(description, DescriptionRole);
-                    keyValueItem->setText(key + ": " + value.toString());
-
-                    subpathItem->appendRow(keyValueItem);
-                    m_childItems.append(keyValueItem);
-                }
+                items.append(qMakePair(subpathItem, new ValueHandler(app, resource, subpath)));
             }
         }
-        m_exportView->setModel(model);
     }
+
+    // 添加 key-value，同一用户的配置通过一次D-Bus调用获取
+    QList<ValueHandler *> handlers;
+    handlers.reserve(items.size());
+    for (const auto &item : items)
+        handlers << item.second;
+    const auto &managers = ValueHandler::createManagers(handlers);
+    for (int i = 0; i < items.size(); ++i) {
+        QScopedPointer<ConfigGetter> manager(managers[i]);
+        if (!manager) {
+            continue;
+        }
+        auto parentItem = items[i].first;
+        auto handler = items[i].second;
+        const auto &values = manager->allValues();
+        for (auto key : manager->keyList()) {
+            auto keyValueItem = new DStandardItem();
+            keyValueItem->setCheckable(true);
+
+            keyValueItem->setData(handler->appid, AppidRole);
+            keyValueItem->setData(handler->fileName, ResourceRole);
+            keyValueItem->setData(handler->subpath, SubpathRole);
+            QVariant value =  values.value(key);
+            keyValueItem->setData(key, KeyRole);
+            keyValueItem->setData(value, ValueRole);
+            QVariant description = manager.get()->description(key, language);
+            keyValueItem->setData(description, DescriptionRole);
+            keyValueItem->setText(key + ": " + value.toString());
+
+            parentItem->appendRow(keyValueItem);
+            m_childItems.append(keyValueItem);
+        }
+    }
+    qDeleteAll(handlers);
+    m_exportView->setModel(model);
 }
 
 void ExportDialog::treeItemChanged(QStandardItem *item)
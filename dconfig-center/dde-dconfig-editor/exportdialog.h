@@ -10,7 +10,6 @@
 #include <DStandardItem>
 #include <DSuggestButton>
 
-class ValueHandler;
 class QTreeView;
 
 DWIDGET_USE_NAMESPACE
@@ -33,7 +32,6 @@ private:
 private:
     QTreeView *m_exportView = nullptr;
     DSuggestButton *m_exportBtn = nullptr;
-    QScopedPointer<ValueHandler> m_getter;
     QList<DStandardItem *> m_rootItems, m_childItems;
 };
 
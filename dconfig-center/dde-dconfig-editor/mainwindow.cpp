@@ -537,13 +537,15 @@ void Content::refreshResourceKeys(const QString &appid, const QString &resourceI
     if(!manager) {
         return;
     }
+    const auto &descriptions = manager->describe(m_language);
     for (auto key : manager->keyList()) {
 
         if (!matchKeyId.isEmpty() && !key.contains(matchKeyId, Qt::CaseInsensitive)) {
             continue;
         }
 
-        if (!isVisible(manager.get(), key)) {
+        const auto &info = descriptions.value(key);
+        if (info.value("visibility").toString() != "public") {
             // TODO visiblity
             //            continue;
             ;
@@ -553,7 +555,7 @@ void Content::refreshResourceKeys(const QString &appid, const QString &resourceI
         keyItem->setSizePolicy(QSizePolicy::Expanding, QSizePolicy::Preferred);
 
 
-        keyItem->setBaseInfo(manager.get(), m_language);
+        keyItem->setBaseInfo(info);
 
         connect(keyItem, &KeyContent::valueChanged, this, &Content::onValueChanged);
 
@@ -576,12 +578,6 @@ ValueHandler *Content::getter()
     return m_getter.get();
 }
 
-bool Content::isVisible(ConfigGetter *manager, const QString &key)
-{
-    const QString &visiblity = manager->visibility(key);
-    return  visiblity == "public" ? true : false;
-}
-
 void Content::onValueChanged(const QVariant &value)
 {
     if (!m_getter) {
@@ -686,28 +682,21 @@ KeyContent::KeyContent(const QString &key, QWidget *parent)
 {
 }
 
-void KeyContent::setBaseInfo(ConfigGetter *getter, const QString &language)
+void KeyContent::setBaseInfo(const QVariantMap &info)
 {
-    const QVariant &v = getter->value(m_key);
+    const QVariant &v = info.value("value");
 
-    const QString &permissions = getter->permissions(m_key);
+    const QString &permissions = info.value("permissions").toString();
     bool canWrite = permissions == "readwrite" ? true : false;
     qDebug() << "key and value " << m_key << v;
 
-    QString displayName = getter->displayName(m_key, language);
+    QString displayName = info.value("name").toString();
     if (displayName.isEmpty()) {
-        displayName = getter->displayName(m_key, QString());
-        if (displayName.isEmpty()) {
-            displayName = m_key;
-        }
+        displayName = m_key;
     }
     DLabel *labelWidget = new DLabel(QString("%1 [%2]").arg(displayName, m_key));
     labelWidget->setObjectName("label-view");
-    QString description = getter->description(m_key, language);
-    if (description.isEmpty()) {
-        description = getter->description(m_key, QString());
-    }
-    labelWidget->setToolTip(description);
+    labelWidget->setToolTip(info.value("description").toString());
 
     m_hLay->addWidget(labelWidget);
     QWidget *valueWidget = nullptr;
@@ -748,7 +737,7 @@ void KeyContent::setBaseInfo(ConfigGetter *getter, const QString &language)
         valueWidget->setObjectName("value-view");
         m_hLay->addWidget(valueWidget);
     }
-    updateContent(getter);
+    updateContent(info.value("isDefaultValue").toBool(), v);
 }
 
 QString KeyContent::key() const
@@ -757,13 +746,16 @@ QString KeyContent::key() const
 }
 
 void KeyContent::updateContent(ConfigGetter *getter)
+{
+    updateContent(getter->isDefaultValue(m_key), getter->value(m_key));
+}
+
+void KeyContent::updateContent(bool isDefaultValue, const QVariant &v)
 {
     if (auto widget = findChild<DLabel*>("label-view")) {
-        const bool isDefaultValue = getter->isDefaultValue(m_key);
         widget->setText(handleModificationInfomation(widget->text(), isDefaultValue));
     }
     if (auto viewWidget = findChild<QWidget *>("value-view")) {
-        const QVariant &v = getter->value(m_key);
         if (auto widget = qobject_cast<DSwitchButton*>(viewWidget)) {
             widget->setChecked(v.toBool());
         } else if (auto widget = qobject_cast<DDoubleSpinBox *>(viewWidget)) {
@@ -34,9 +34,10 @@ class KeyContent : public QWidget{
     Q_OBJECT
 public:
     KeyContent(const QString &key, QWidget *parent = nullptr);
-    void setBaseInfo(ConfigGetter *getter, const QString &language);
+    void setBaseInfo(const QVariantMap &info);
     QString key() const;
     void updateContent(ConfigGetter *getter);
+    void updateContent(bool isDefaultValue, const QVariant &value);
 
 private Q_SLOTS:
     void onDoubleValueChanged(double value);
@@ -62,7 +63,6 @@ public:
     void clear();
 
     ValueHandler *getter();
-    static bool isVisible(ConfigGetter *manager, const QString &key);
 
     static void remove(QLayout *layout);
 
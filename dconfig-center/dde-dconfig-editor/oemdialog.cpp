@@ -79,14 +79,16 @@ void OEMDialog::loadData(const QString &language)
             if (!manager) {
                 continue;
             }
+            const auto &descriptions = manager->describe(language);
             for (auto key : manager->keyList()) {
                 auto keyItem = new DStandardItem();
                 keyItem->setText(key);
                 keyItem->setEditable(false);
 
-                QVariant value =  manager.get()->value(key);
-                QVariant description = manager.get()->description(key, language);
-                QVariant flags = manager.get()->flags(key);
+                const auto &info = descriptions.value(key);
+                QVariant value = info.value("value");
+                QVariant description = info.value("description");
+                QVariant flags = info.value("flags");
                 auto valueItem = new DStandardItem();
                 valueItem->setSizeHint(QSize(200, 45));
                 valueItem->setData(app, AppidRole);
@@ -114,15 +116,17 @@ void OEMDialog::loadData(const QString &language)
                 if (!manager) {
                     continue;
                 }
+                const auto &descriptions = manager->describe(language);
                 for (auto key : manager->keyList()) {
                     auto keyItem = new DStandardItem();
                     keyItem->setText(key);
                     keyItem->setEditable(false);
 
-                    QVariant value =  manager.get()->value(key);
-                    QVariant description = manager.get()->description(key, language);
+                    const auto &info = descriptions.value(key);
+                    QVariant value = info.value("value");
+                    QVariant description = info.value("description");
                     auto valueItem = new DStandardItem(value.toString());
-                    QVariant flags = manager.get()->flags(key);
+                    QVariant flags = info.value("flags");
                     valueItem->setData(app, AppidRole);
                     valueItem->setData(resource, ResourceRole);
                     valueItem->setData(subpath, SubpathRole);
@@ -96,6 +96,81 @@ TEST_F(ut_DConfigResource, fallbackToGenericConfig) {
     resource->load(APP_ID);
     ASSERT_TRUE(resource->fallbackToGenericConfig());
 }
+TEST_F(ut_DConfigResource, fallbackToGenericConfigCached) {
+
+    resource->load(APP_ID);
+    ASSERT_TRUE(resource->fallbackToGenericConfig());
+
+    const QString backupPath = noAppIdConfigPath() + ".bak";
+    ASSERT_TRUE(QFile::rename(noAppIdConfigPath(), backupPath));
+    // keep the result until the resource is updated.
+    EXPECT_TRUE(resource->fallbackToGenericConfig());
+    resource->reparse(VirtualInterAppId);
+    EXPECT_FALSE(resource->fallbackToGenericConfig());
+    ASSERT_TRUE(QFile::rename(backupPath, noAppIdConfigPath()));
+}
+TEST_F(ut_DConfigResource, reparseChangedKeys) {
+
+    ASSERT_TRUE(resource->load(APP_ID));
+    auto conn = resource->createConn(APP_ID, TestUid);
+    ASSERT_TRUE(conn);
+    QSignalSpy spy(conn, &DSGConfigConn::valueChanged);
+
+    QFile source(":/config/example.json");
+    ASSERT_TRUE(source.open(QIODevice::ReadOnly));
+    const QByteArray original = source.readAll();
+    QByteArray modified = original;
+    modified.replace("\"value\": \"125\"", "\"value\": \"126\"");
+    ASSERT_NE(modified, original);
+
+    QFile::setPermissions(configPath(), QFile::ReadOwner | QFile::WriteOwner);
+    {
+        QFile file(configPath());
+        ASSERT_TRUE(file.open(QIODevice::WriteOnly | QIODevice::Truncate));
+        file.write(modified);
+    }
+    // only the key whose default value changed is notified.
+    ASSERT_TRUE(resource->reparse(APP_ID));
+    ASSERT_EQ(spy.count(), 1);
+    ASSERT_EQ(spy.takeFirst().at(0).toString(), QString("key2"));
+
+    // nothing is changed.
+    ASSERT_TRUE(resource->reparse(APP_ID));
+    ASSERT_EQ(spy.count(), 0);
+
+    QFile file(configPath());
+    ASSERT_TRUE(file.open(QIODevice::WriteOnly | QIODevice::Truncate));
+    file.write(original);
+}
+TEST_F(ut_DConfigResource, connKey) {
+
+    const auto connKey = resource->getConnKey(APP_ID, TestUid);
+    ASSERT_EQ(connKey.toString(), QString("/%1/%2/%3").arg(APP_ID, FILE_NAME).arg(TestUid));
+    ASSERT_EQ(connKey, getConnectionKey(getResourceKey(APP_ID, getGenericResourceKey(FILE_NAME, "")), TestUid));
+    ASSERT_EQ(getGenericResourceKey(connKey), resource->key());
+    ASSERT_EQ(getConnectionKey(connKey), static_cast<uint>(TestUid));
+    ASSERT_FALSE(isGenericResourceConn(connKey));
+
+    const auto genericConnKey = resource->getConnKey(VirtualInterAppId, TestUid);
+    ASSERT_TRUE(isGenericResourceConn(genericConnKey));
+    ASSERT_EQ(getGenericResourceKey(genericConnKey), getGenericResourceKey(connKey));
+}
+TEST_F(ut_DConfigResource, connectionIndexScaling) {
+
+    constexpr uint ConnCount = 10000;
+    resource->load(APP_ID);
+    for (uint uid = 1; uid <= ConnCount; uid++)
+        ASSERT_TRUE(resource->createConn(APP_ID, uid));
+    ASSERT_EQ(resource->connSize(), static_cast<int>(ConnCount));
+
+    for (uint uid = 1; uid <= ConnCount; uid++)
+        ASSERT_EQ(resource->getConnectionsByUid(uid).size(), 1);
+
+    for (uint uid = 1; uid <= ConnCount; uid++)
+        resource->removeConn(getConnectionKey(getResourceKey(APP_ID, getGenericResourceKey(FILE_NAME, "")), uid));
+    ASSERT_TRUE(resource->isEmptyConn());
+    ASSERT_TRUE(resource->getConnectionsByUid(1).isEmpty());
+}
 
 class ut_DConfigConn : public testing::Test
 {
@@ -201,7 +276,7 @@ TEST_F(ut_DConfigConn, fallbackToGenericValue) {
     auto genericConn = resource->createConn(VirtualInterAppId, TestUid);
     ASSERT_TRUE(genericConn);
     genericConn->setValue("canExit", QDBusVariant{false});
-    resource->removeConn(genericConn->path());
+    resource->removeConn(genericConn->key());
     ASSERT_EQ(resource->connSize(), 1);
 
     // fallback to generic value
@@ -218,13 +293,38 @@ TEST_F(ut_DConfigConn, appValue) {
     auto genericConn = resource->createConn(VirtualInterAppId, TestUid);
     ASSERT_TRUE(genericConn);
     genericConn->setValue("canExit", QDBusVariant{true});
-    resource->removeConn(genericConn->path());
+    resource->removeConn(genericConn->key());
     ASSERT_EQ(resource->connSize(), 1);
 
     // can't fallback to generic value
     ASSERT_EQ(conn->value("canExit").variant(), false);
 }
 
+TEST_F(ut_DConfigConn, valueCache) {
+    conn->setValue("canExit", QDBusVariant{false});
+    const auto hits = conn->valueCacheHits();
+    ASSERT_EQ(conn->value("canExit").variant(), false);
+    ASSERT_EQ(conn->value("canExit").variant(), false);
+    ASSERT_EQ(conn->valueCacheHits(), hits + 1);
+
+    // setValue invalidates the resolved value.
+    conn->setValue("canExit", QDBusVariant{true});
+    ASSERT_EQ(conn->value("canExit").variant(), true);
+
+    // generic value changing invalidates the fallback value.
+    conn->reset("canExit");
+    ASSERT_EQ(conn->value("canExit").variant(), true);
+    ASSERT_TRUE(resource->load(VirtualInterAppId));
+    auto genericConn = resource->createConn(VirtualInterAppId, TestUid);
+    ASSERT_TRUE(genericConn);
+    genericConn->setValue("canExit", QDBusVariant{false});
+    ASSERT_EQ(conn->value("canExit").variant(), false);
+    genericConn->reset("canExit");
+    ASSERT_EQ(conn->value("canExit").variant(), true);
+    resource->removeConn(genericConn->key());
+    ASSERT_GT(conn->valueCacheHitRatio(), 0.0);
+}
+
 TEST_F(ut_DConfigConn, isDefaultValue) {
     conn->reset("canExit");
     ASSERT_TRUE(conn->isDefaultValue("canExit"));
@@ -235,3 +335,49 @@ TEST_F(ut_DConfigConn, isDefaultValue) {
     conn->reset("canExit");
     ASSERT_TRUE(conn->isDefaultValue("canExit"));
 }
+
+TEST_F(ut_DConfigConn, bulkValues) {
+    conn->resetAll();
+
+    QSignalSpy spy(conn, &DSGConfigConn::valueChanged);
+    conn->setValues({{"canExit", false}, {"key2", QString("126")}, {"noexist", 1}});
+    ASSERT_EQ(spy.count(), 2);
+
+    const auto values = conn->values({"canExit", "key2", "noexist"});
+    ASSERT_EQ(values.size(), 2);
+    ASSERT_EQ(values.value("canExit"), false);
+    ASSERT_EQ(values.value("key2"), QString("126"));
+
+    const auto all = conn->allValues();
+    ASSERT_EQ(all.size(), conn->keyList().size());
+    ASSERT_EQ(all.value("canExit"), false);
+
+    spy.clear();
+    conn->resetAll();
+    ASSERT_EQ(spy.count(), 2);
+    ASSERT_TRUE(conn->isDefaultValue("canExit"));
+    ASSERT_TRUE(conn->isDefaultValue("key2"));
+    ASSERT_EQ(conn->value("canExit").variant(), true);
+}
+
+TEST_F(ut_DConfigConn, describe) {
+    conn->reset("canExit");
+    conn->setValue("key2", QDBusVariant{QString("126")});
+
+    const auto descriptions = conn->describe("en_US");
+    ASSERT_EQ(descriptions.size(), conn->keyList().size());
+
+    const auto canExit = descriptions.value("canExit");
+    ASSERT_EQ(canExit.value("name"), conn->name("canExit", "en_US"));
+    ASSERT_EQ(canExit.value("description"), QString("I am description"));
+    ASSERT_EQ(canExit.value("value"), true);
+    ASSERT_EQ(canExit.value("isDefaultValue"), true);
+    ASSERT_EQ(canExit.value("visibility"), QString("private"));
+    ASSERT_EQ(canExit.value("permissions"), QString("readwrite"));
+    ASSERT_EQ(canExit.value("flags"), 0);
+
+    const auto key2 = descriptions.value("key2");
+    ASSERT_EQ(key2.value("value"), QString("126"));
+    ASSERT_EQ(key2.value("isDefaultValue"), false);
+    conn->reset("key2");
+}
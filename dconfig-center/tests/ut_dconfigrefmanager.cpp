@@ -32,9 +32,14 @@ protected:
     const char* Service1 = "service1";
     const char* Service2 = "service2";
 
-    const char* Resource1 = "resource1";
-    const char* Resource2 = "resource2";
-    const char* Resource3 = "resource3";
+    const ConnKey Resource1 = resourceKey("resource1");
+    const ConnKey Resource2 = resourceKey("resource2");
+    const ConnKey Resource3 = resourceKey("resource3");
+
+    static ConnKey resourceKey(const QString &name)
+    {
+        return getConnectionKey(getResourceKey(VirtualInterAppId, getGenericResourceKey(name, QString())), TestUid);
+    }
 };
 
 TEST_F(ut_DConfigRefServer, refResource) {
@@ -233,18 +238,20 @@ TEST_F(ut_ConfigSyncRequestCache, base) {
 
     QSignalSpy spy(cache.data(), &ConfigSyncRequestCache::syncConfigRequest);
 
-    const QString userKey("user-config");
+    const auto resourceKey = getResourceKey(VirtualInterAppId, getGenericResourceKey("config", QString()));
+    const auto userKey = getConnectionKey(resourceKey, TestUid);
     const auto userConfigCacheKey = ConfigSyncRequestCache::userKey(userKey);
     ASSERT_TRUE(ConfigSyncRequestCache::isUserKey(userConfigCacheKey));
     ASSERT_EQ(ConfigSyncRequestCache::getUserKey(userConfigCacheKey), userKey);
 
-    const QString globalKey("global-config");
+    const auto globalKey = resourceKey;
     const auto globalConfigCacheKey = ConfigSyncRequestCache::globalKey(globalKey);
     ASSERT_TRUE(ConfigSyncRequestCache::isGlobalKey(globalConfigCacheKey));
     ASSERT_EQ(ConfigSyncRequestCache::getGlobalKey(globalConfigCacheKey), globalKey);
+    ASSERT_NE(userConfigCacheKey, globalConfigCacheKey);
 
-    cache->pushRequest(userKey);
-    cache->pushRequest(globalKey);
+    cache->pushRequest(userConfigCacheKey);
+    cache->pushRequest(globalConfigCacheKey);
 
     ASSERT_EQ(cache->requestsCount(), 2);
 
@@ -258,3 +265,49 @@ TEST_F(ut_ConfigSyncRequestCache, base) {
 
     ASSERT_EQ(cache->requestsCount(), 0);
 }
+
+TEST_F(ut_ConfigSyncRequestCache, order) {
+    qRegisterMetaType<ConfigSyncBatchRequest>();
+    cache->setDelaySyncTime(50);
+    cache->setBatchCount(2);
+
+    QSignalSpy spy(cache.data(), &ConfigSyncRequestCache::syncConfigRequest);
+    const auto takeRequests = [&spy]() {
+        QList<ConfigCacheKey> keys;
+        while (!spy.isEmpty())
+            keys << spy.takeFirst().first().value<ConfigSyncBatchRequest>().data;
+        return keys;
+    };
+
+    const auto resourceKey = getResourceKey(VirtualInterAppId, getGenericResourceKey("config", QString()));
+    const auto normalKey = ConfigSyncRequestCache::userKey(getConnectionKey(resourceKey, 1));
+    const auto lazyKey = ConfigSyncRequestCache::userKey(getConnectionKey(resourceKey, 2));
+    const auto immediateKey = ConfigSyncRequestCache::globalKey(resourceKey);
+
+    cache->pushRequest(lazyKey, ConfigSyncRequestCache::Lazy);
+    cache->pushRequest(normalKey);
+    cache->pushRequest(immediateKey, ConfigSyncRequestCache::Immediate);
+    ASSERT_EQ(cache->requestsCount(), 3);
+
+    // the immediate request doesn't wait for the delay.
+    ASSERT_TRUE(spy.wait(cache->delaySyncTime() / 2));
+    ASSERT_EQ(takeRequests(), QList<ConfigCacheKey>{immediateKey});
+
+    // the deadline is counted from the first change, the earlier change is saved first.
+    cache->pushRequest(lazyKey);
+    while (cache->requestsCount() > 0 && spy.wait(cache->delaySyncTime() * 2)) {}
+    ASSERT_EQ(takeRequests(), (QList<ConfigCacheKey>{lazyKey, normalKey}));
+
+    // flush doesn't wait for the deadline.
+    cache->pushRequest(lazyKey, ConfigSyncRequestCache::Lazy);
+    cache->flush();
+    ASSERT_EQ(takeRequests(), QList<ConfigCacheKey>{lazyKey});
+    ASSERT_EQ(cache->requestsCount(), 0);
+
+    // the slow writes shrink the batch.
+    cache->reportLatency(2, 1000);
+    ASSERT_EQ(cache->adaptiveBatchCount(), 1);
+    cache->setBatchCount(2);
+    cache->reportLatency(2, 1);
+    ASSERT_EQ(cache->adaptiveBatchCount(), 2);
+}
@@ -3,18 +3,30 @@
 // SPDX-License-Identifier: LGPL-3.0-or-later
 
 #include <QBuffer>
+#include <QCoreApplication>
 #include <QDir>
 #include <QFile>
 #include <QSignalSpy>
 #include <QThread>
+#include <QElapsedTimer>
+#include <QRegularExpression>
 
 #include <gtest/gtest.h>
 
+#include <optional>
+
 #include <DConfigFile>
 
 #include "dconfigserver.h"
 #include "dconfigresource.h"
 #include "dconfigconn.h"
+#include "dconfigwatcher.h"
+#include "dconfigsignatureindex.h"
+#include "dconfigpathtrie.h"
+#include "dconfigmetadatabase.h"
+#include "dconfigjournal.h"
+#include "dconfigpersister.h"
+#include "dconfigrefmanager.h"
 #include "test_helper.hpp"
 
 DCORE_USE_NAMESPACE
@@ -23,6 +35,19 @@ static constexpr char const *LocalPrefix = "/tmp/example/";
 static constexpr char const *APP_ID = "org.foo.appid";
 static constexpr char const *FILE_NAME = "example";
 
+// object path of the connection: /appid/name/[subpath/]uid
+static GenericResourceKey getGenericResourceKey(const QString &path)
+{
+    const auto sections = path.split('/', Qt::SkipEmptyParts);
+    if (sections.size() < 3)
+        return GenericResourceKey();
+
+    QString subpath;
+    for (int i = 2; i < sections.size() - 1; i++)
+        subpath += "/" + sections[i];
+    return getGenericResourceKey(sections[1], subpath);
+}
+
 class ut_DConfigServer : public testing::Test
 {
 protected:
@@ -77,7 +102,7 @@ TEST_F(ut_DConfigServer, acquireManager) {
     ASSERT_EQ(server->resourceSize(), 1);
 
     auto path2 = server->acquireManager(APP_ID, "example_noexist", QString("")).path();
-    ASSERT_EQ(server->resourceObject(path2), nullptr);
+    ASSERT_EQ(server->resourceObject(getGenericResourceKey(path2)), nullptr);
     ASSERT_EQ(server->resourceSize(), 1);
 }
 
@@ -87,8 +112,78 @@ TEST_F(ut_DConfigServer, acquireManagerV2) {
     ASSERT_EQ(server->resourceSize(), 1);
 
     auto path2 = server->acquireManager(APP_ID, "example_noexist", QString("")).path();
-    ASSERT_EQ(server->resourceObject(path2), nullptr);
+    ASSERT_EQ(server->resourceObject(getGenericResourceKey(path2)), nullptr);
+    ASSERT_EQ(server->resourceSize(), 1);
+}
+
+TEST_F(ut_DConfigServer, acquireManagers) {
+    const ConfigResourceIdList resources {
+        {APP_ID, FILE_NAME, QString("")},
+        {APP_ID, "example_noexist", QString("")},
+        {"org.foo.appid2", FILE_NAME, QString("")},
+    };
+    const auto paths = server->acquireManagers(TestUid, resources);
+    ASSERT_EQ(paths.size(), resources.size());
+    ASSERT_EQ(paths[0].path(),
+              formatDBusObjectPath(QString("/%1/%2/%3").arg(APP_ID, FILE_NAME, QString::number(TestUid))));
+    ASSERT_EQ(paths[1].path(), QString("/"));
+    ASSERT_EQ(paths[2].path(),
+              formatDBusObjectPath(QString("/%1/%2/%3").arg("org.foo.appid2", FILE_NAME, QString::number(TestUid))));
     ASSERT_EQ(server->resourceSize(), 1);
+
+    ASSERT_EQ(server->acquireManagerV2(TestUid, APP_ID, FILE_NAME, QString("")).path(), paths[0].path());
+}
+
+TEST_F(ut_DConfigServer, acquireManagerPath) {
+
+    const auto path = server->acquireManagerV2(TestUid, APP_ID, FILE_NAME, QString("")).path();
+    auto resource = server->resourceObject(getGenericResourceKey(path));
+    ASSERT_TRUE(resource);
+    auto conn = resource->getConn(APP_ID, TestUid);
+    ASSERT_TRUE(conn);
+    const auto connKey = conn->key().toString();
+
+    // the path was formatted by QRegularExpression on each acquire before,
+    // the cost is only logged, the elapsed time isn't stable enough to be checked.
+    constexpr int Count = 10000;
+    const QRegularExpression regex(QStringLiteral("[\\. -]"));
+    QElapsedTimer timer;
+    timer.start();
+    for (int i = 0; i < Count; i++)
+        ASSERT_EQ(QString(connKey).replace(regex, QStringLiteral("_")), path);
+    const qint64 regexCost = timer.nsecsElapsed();
+
+    timer.restart();
+    for (int i = 0; i < Count; i++)
+        ASSERT_EQ(formatDBusObjectPath(connKey), path);
+    const qint64 formatCost = timer.nsecsElapsed();
+
+    // the stored path is returned for the later acquires.
+    timer.restart();
+    for (int i = 0; i < Count; i++)
+        ASSERT_EQ(server->acquireManagerV2(TestUid, APP_ID, FILE_NAME, QString("")).path(), path);
+    const qint64 acquireCost = timer.nsecsElapsed();
+
+    qInfo("Path cost per acquire, regex:%lld ns, translator:%lld ns, acquire with the stored path:%lld ns.",
+          regexCost / Count, formatCost / Count, acquireCost / Count);
+}
+
+TEST_F(ut_DConfigServer, keyAtoms) {
+    const auto path = server->acquireManager(APP_ID, FILE_NAME, QString("")).path();
+    const int size = ConfigKeyAtoms::size();
+
+    // the names of the failed requests aren't kept.
+    for (int i = 0; i < 100; i++) {
+        ASSERT_TRUE(server->acquireManager(QString("noexist.app%1").arg(i), QString("noexist%1").arg(i),
+                                           QString("/noexist%1").arg(i)).path().isEmpty());
+    }
+    ASSERT_LE(ConfigKeyAtoms::size(), size);
+    quint32 id = 0;
+    ASSERT_FALSE(ConfigKeyAtoms::find("noexist0", &id));
+
+    // the names of the loaded resource are kept.
+    ASSERT_TRUE(ConfigKeyAtoms::find(FILE_NAME, &id));
+    ASSERT_EQ(server->acquireManager(APP_ID, FILE_NAME, QString("")).path(), path);
 }
 
 TEST_F(ut_DConfigServer, resourceSize) {
@@ -151,6 +246,417 @@ TEST_F(ut_DConfigServer, setDelayReleaseTime) {
     ASSERT_EQ(spy.count(), 1);
 }
 
+TEST_F(ut_DConfigServer, initializeAsync) {
+    server->initialize();
+    // requests are served while initializing.
+    ASSERT_EQ(server->acquireManager(APP_ID, FILE_NAME, QString("")).path(),
+              formatDBusObjectPath(QString("/%1/%2/%3").arg(APP_ID, FILE_NAME, QString::number(TestUid))));
+    server->reload();
+
+    server->waitForInitialized();
+    ASSERT_TRUE(server->isInitialized());
+    ASSERT_TRUE(server->listApps().contains(APP_ID));
+}
+
+TEST_F(ut_DConfigServer, updateAsync) {
+    server->acquireManager(APP_ID, FILE_NAME, QString(""));
+    auto resource = server->resourceObject(getGenericResourceKey(FILE_NAME, ""));
+    ASSERT_TRUE(resource);
+    const auto &resourceKey = getResourceKey(APP_ID, resource->key());
+    auto file = resource->getFile(resourceKey);
+
+    // the file is replaced in the event loop after parsing, only the last update is used.
+    server->update(configPath());
+    server->update(configPath());
+    ASSERT_EQ(resource->getFile(resourceKey), file);
+
+    QElapsedTimer timer;
+    timer.start();
+    while (resource->getFile(resourceKey) == file && timer.elapsed() < 3000)
+        QCoreApplication::processEvents(QEventLoop::AllEvents, 50);
+    ASSERT_NE(resource->getFile(resourceKey), file);
+    ASSERT_TRUE(resource->getConn(APP_ID, TestUid));
+}
+
+TEST_F(ut_DConfigServer, updateKeepsGlobalValue) {
+    server->acquireManager(APP_ID, FILE_NAME, QString(""));
+    auto resource = server->resourceObject(getGenericResourceKey(FILE_NAME, ""));
+    ASSERT_TRUE(resource);
+    const auto &resourceKey = getResourceKey(APP_ID, resource->key());
+    auto file = resource->getFile(resourceKey);
+    auto conn = resource->getConn(APP_ID, TestUid);
+    ASSERT_TRUE(conn);
+
+    // the global value changed while parsing is kept by the new file.
+    server->update(configPath());
+    conn->setValue("array", QDBusVariant{QStringList{"value3"}});
+
+    QElapsedTimer timer;
+    timer.start();
+    while (resource->getFile(resourceKey) == file && timer.elapsed() < 3000)
+        QCoreApplication::processEvents(QEventLoop::AllEvents, 50);
+    ASSERT_NE(resource->getFile(resourceKey), file);
+    ASSERT_EQ(resource->getFile(resourceKey)->globalCache()->value("array").toStringList(), QStringList{"value3"});
+    ASSERT_EQ(conn->value("array").variant().toStringList(), QStringList{"value3"});
+}
+
+TEST_F(ut_DConfigServer, reloadModifiedInPlace) {
+    server->initialize();
+    server->waitForInitialized();
+    server->acquireManager(APP_ID, FILE_NAME, QString(""));
+    auto resource = server->resourceObject(getGenericResourceKey(FILE_NAME, ""));
+    ASSERT_TRUE(resource);
+    const auto &resourceKey = getResourceKey(APP_ID, resource->key());
+    auto file = resource->getFile(resourceKey);
+
+    // rewriting the file doesn't change the directory's modified time.
+    {
+        QFile meta(configPath());
+        ASSERT_TRUE(meta.open(QIODevice::Append));
+        meta.write("\n");
+    }
+    server->reload();
+
+    QElapsedTimer timer;
+    timer.start();
+    while (resource->getFile(resourceKey) == file && timer.elapsed() < 3000)
+        QCoreApplication::processEvents(QEventLoop::AllEvents, 50);
+    ASSERT_NE(resource->getFile(resourceKey), file);
+}
+
+TEST_F(ut_DConfigServer, catalog) {
+    server->initialize();
+    ASSERT_TRUE(server->listApps().contains(APP_ID));
+    ASSERT_FALSE(server->listApps().contains(QString()));
+    ASSERT_EQ(server->listResources(APP_ID), QStringList{FILE_NAME});
+    ASSERT_TRUE(server->listResources(QString()).contains(FILE_NAME));
+    ASSERT_TRUE(server->listSubpaths(APP_ID, FILE_NAME).isEmpty());
+
+    const QString subpathConfig = QString("%1/a/b/%2.json").arg(QFileInfo(configPath()).path(), FILE_NAME);
+    QDir().mkpath(QFileInfo(subpathConfig).path());
+    ASSERT_TRUE(QFile::copy(":/config/example.json", subpathConfig));
+    server->update(subpathConfig);
+    ASSERT_EQ(server->listSubpaths(APP_ID, FILE_NAME), QStringList{"/a/b"});
+    ASSERT_TRUE(server->listSubpaths(QString(), FILE_NAME).contains(QString("/%1/a/b").arg(APP_ID)));
+
+    ASSERT_TRUE(QFile::remove(subpathConfig));
+    server->update(subpathConfig);
+    ASSERT_TRUE(server->listSubpaths(APP_ID, FILE_NAME).isEmpty());
+
+    server->reload();
+    ASSERT_EQ(server->listResources(APP_ID), QStringList{FILE_NAME});
+}
+
+TEST_F(ut_DConfigServer, fileWatcher) {
+    const QString root = QString("%1/watcher/configs").arg(LocalPrefix);
+    QDir(root).removeRecursively();
+
+    DSGConfigWatcher watcher;
+    watcher.setDebounceTime(10);
+    // the root is created after watching.
+    ASSERT_TRUE(watcher.start({root}));
+    QSignalSpy spy(&watcher, &DSGConfigWatcher::filesChanged);
+
+    const QString path = QString("%1/%2/%3.json").arg(root, APP_ID, FILE_NAME);
+    ASSERT_TRUE(QDir().mkpath(QFileInfo(path).path()));
+    ASSERT_TRUE(QFile::copy(":/config/example.json", path));
+    watcher.flush();
+    ASSERT_EQ(spy.count(), 1);
+    ASSERT_EQ(spy.takeFirst().at(0).toStringList(), QStringList{QDir::cleanPath(path)});
+
+    ASSERT_TRUE(QFile::remove(path));
+    ASSERT_TRUE(spy.wait(1000));
+    ASSERT_EQ(spy.takeFirst().at(0).toStringList(), QStringList{QDir::cleanPath(path)});
+
+    watcher.stop();
+    QDir(QString("%1/watcher").arg(LocalPrefix)).removeRecursively();
+}
+
+TEST_F(ut_DConfigServer, signatureIndex) {
+    const QString root = QString("%1/signature/configs").arg(LocalPrefix);
+    QDir(root).removeRecursively();
+    const QString path = QDir::cleanPath(QString("%1/%2/%3.json").arg(root, APP_ID, FILE_NAME));
+    ASSERT_TRUE(QDir().mkpath(QFileInfo(path).path()));
+    ASSERT_TRUE(QFile::copy(":/config/example.json", path));
+
+    DSGConfigSignatureIndex index;
+    ASSERT_EQ(index.scan({root}), QStringList{path});
+    ASSERT_TRUE(index.contains(path));
+    ASSERT_TRUE(index.scan({root}).isEmpty());
+
+    // added file changes the directory's modified time.
+    const QString added = QDir::cleanPath(QString("%1/%2/a/%3.json").arg(root, APP_ID, FILE_NAME));
+    ASSERT_TRUE(QDir().mkpath(QFileInfo(added).path()));
+    ASSERT_TRUE(QFile::copy(":/config/example.json", added));
+    ASSERT_EQ(index.scan({root}), QStringList{added});
+
+    // modified in place, it's detected without pruning or by update.
+    {
+        QFile file(path);
+        ASSERT_TRUE(file.open(QIODevice::Append));
+        file.write("\n");
+    }
+    ASSERT_TRUE(index.update(path));
+    ASSERT_FALSE(index.update(path));
+    ASSERT_TRUE(index.scan({root}, false).isEmpty());
+
+    const QString indexPath = QString("%1/signature/file-signatures.index").arg(LocalPrefix);
+    ASSERT_TRUE(index.save(indexPath));
+    DSGConfigSignatureIndex loaded;
+    ASSERT_TRUE(loaded.load(indexPath));
+    ASSERT_EQ(loaded.size(), 2);
+
+    ASSERT_TRUE(QFile::remove(added));
+    ASSERT_EQ(loaded.scan({root}), QStringList{added});
+    ASSERT_FALSE(loaded.contains(added));
+
+    QDir(QString("%1/signature").arg(LocalPrefix)).removeRecursively();
+}
+
+TEST_F(ut_DConfigServer, metaDatabase) {
+    const QString path = QString("%1/meta/meta.db").arg(LocalPrefix);
+    ASSERT_TRUE(DSGConfigServer::compileMetaDatabase(path, LocalPrefix));
+
+    DSGConfigMetaDatabase database;
+    ASSERT_TRUE(database.open(path));
+    ASSERT_TRUE(database.meta(APP_ID, FILE_NAME, "").isValid());
+    ASSERT_TRUE(database.meta(QString(), FILE_NAME, "/").isValid());
+    ASSERT_FALSE(database.meta("org.foo.notexist", FILE_NAME, "").isValid());
+
+    // the same meta file is stored once for the app and the generic subpath.
+    const auto &appMeta = database.meta(APP_ID, FILE_NAME, "");
+    const auto &subpathMeta = database.meta(QString(), FILE_NAME, QString("/%1").arg(APP_ID));
+    ASSERT_TRUE(subpathMeta.isValid());
+    ASSERT_EQ(appMeta.meta.constData(), subpathMeta.meta.constData());
+
+    DSGConfigSignatureIndex index;
+    index.scan({QString("%1/usr/share/dsg/configs").arg(LocalPrefix),
+                QString("%1/etc/dsg/configs/overrides").arg(LocalPrefix)});
+    ASSERT_TRUE(database.isUpToDate(index));
+
+    // loaded from the database.
+    DSGConfigResource resource(FILE_NAME, "", LocalPrefix);
+    resource.setMetaDatabase(&database);
+    ASSERT_TRUE(resource.load(APP_ID));
+    auto conn = resource.createConn(APP_ID, TestUid);
+    ASSERT_TRUE(conn);
+    ASSERT_EQ(conn->value("key2").variant().toString(), QString("125"));
+
+    // the change time of the configuration file is changed.
+    QThread::msleep(10);
+    ASSERT_TRUE(QFile::setPermissions(configPath(), QFile::ReadOwner | QFile::WriteOwner | QFile::ReadGroup));
+    ASSERT_FALSE(database.isUpToDate(index));
+
+    database.close();
+    ASSERT_FALSE(database.isOpen());
+    QDir(QString("%1/meta").arg(LocalPrefix)).removeRecursively();
+}
+
+TEST_F(ut_DConfigServer, journal) {
+    {
+        DSGConfigResource resource(FILE_NAME, "", LocalPrefix);
+        ASSERT_TRUE(resource.load(APP_ID));
+        auto conn = resource.createConn(APP_ID, TestUid);
+        ASSERT_TRUE(conn);
+
+        // the change is appended to the journal instead of saving the cache file.
+        conn->setValue("canExit", QDBusVariant{false});
+        const auto &records = resource.journal().read();
+        ASSERT_EQ(records.size(), 1);
+        ASSERT_EQ(records.first().key, QString("canExit"));
+        ASSERT_EQ(records.first().uid, static_cast<uint>(TestUid));
+        ASSERT_FALSE(records.first().global);
+        ASSERT_EQ(records.first().value, QVariant(false));
+
+        resource.compactJournal();
+        ASSERT_TRUE(resource.journal().isEmpty());
+        ASSERT_FALSE(QFile::exists(resource.journal().path()));
+    }
+
+    // replay the journal which isn't compacted, e.g. the daemon is killed.
+    QString path;
+    {
+        DSGConfigResource resource(FILE_NAME, "", LocalPrefix);
+        path = resource.journal().path();
+    }
+    DSGConfigJournal journal;
+    journal.setPath(path);
+    DSGConfigJournal::Record record;
+    record.appid = APP_ID;
+    record.uid = TestUid;
+    record.key = "canExit";
+    record.value = true;
+    ASSERT_TRUE(journal.append(record));
+    {
+        QFile file(path);
+        ASSERT_TRUE(file.open(QIODevice::Append));
+        // an incomplete record is ignored.
+        file.write(QByteArray::fromHex("000000ff00"));
+    }
+    ASSERT_EQ(journal.read().size(), 1);
+
+    DSGConfigResource resource(FILE_NAME, "", LocalPrefix);
+    ASSERT_TRUE(resource.load(APP_ID));
+    ASSERT_FALSE(QFile::exists(path));
+    auto conn = resource.createConn(APP_ID, TestUid);
+    ASSERT_TRUE(conn);
+    ASSERT_EQ(conn->value("canExit").variant(), QVariant(true));
+}
+
+TEST_F(ut_DConfigServer, persister) {
+    DSGConfigPersister persister;
+    DSGConfigResource resource(FILE_NAME, "", LocalPrefix);
+    resource.setPersister(&persister);
+    ASSERT_TRUE(resource.load(APP_ID));
+    auto conn = resource.createConn(APP_ID, TestUid);
+    ASSERT_TRUE(conn);
+    conn->setValue("canExit", QDBusVariant{false});
+
+    // the snapshot is saved in the persistence thread, the later change isn't in it.
+    std::optional<bool> saved;
+    resource.save(APP_ID, [&saved](bool result) {
+        saved = result;
+    });
+    conn->setValue("canExit", QDBusVariant{true});
+
+    QElapsedTimer timer;
+    timer.start();
+    while (!saved && timer.elapsed() < 3000)
+        QCoreApplication::processEvents(QEventLoop::AllEvents, 50);
+    ASSERT_TRUE(saved.value_or(false));
+    ASSERT_EQ(persister.pendingCount(), 0);
+
+    // the caches are committed together, the staged files are renamed.
+    const auto statistics = persister.statistics();
+    ASSERT_GE(statistics.flushes, 1u);
+    ASSERT_GT(statistics.bytes, 0u);
+    ASSERT_LE(statistics.syncs, statistics.files);
+    ASSERT_TRUE(QDir(LocalPrefix + configPrefixPath() + "/.staging").isEmpty());
+
+    DConfigFile file(APP_ID, FILE_NAME, "");
+    ASSERT_TRUE(file.load(LocalPrefix));
+    std::unique_ptr<DConfigCache> cache(file.createUserCache(TestUid));
+    cache->setCachePathPrefix(configPrefixPath() + QString("/%1").arg(TestUid));
+    ASSERT_TRUE(cache->load(LocalPrefix));
+    ASSERT_EQ(cache->value("canExit"), QVariant(false));
+}
+
+TEST_F(ut_DConfigServer, persisterReleased) {
+    DSGConfigPersister persister;
+    DSGConfigResource resource(FILE_NAME, "", LocalPrefix);
+    resource.setPersister(&persister);
+    ASSERT_TRUE(resource.load(APP_ID));
+    auto conn = resource.createConn(APP_ID, TestUid);
+    ASSERT_TRUE(conn);
+    const auto connKey = conn->key();
+    const auto &cacheKey = ConfigSyncRequestCache::userKey(connKey).toString();
+    conn->setValue("key2", QDBusVariant{QString("released")});
+
+    // the snapshot isn't written until the batch ends, the released cache is kept.
+    persister.beginBatch();
+    resource.removeConn(connKey);
+    ASSERT_FALSE(resource.getConn(connKey));
+    ASSERT_TRUE(persister.released(cacheKey));
+
+    // loading again before the snapshot is written uses the released content.
+    ASSERT_TRUE(resource.load(APP_ID));
+    conn = resource.createConn(APP_ID, TestUid);
+    ASSERT_TRUE(conn);
+    ASSERT_EQ(conn->value("key2").variant().toString(), QString("released"));
+
+    persister.endBatch();
+    QElapsedTimer timer;
+    timer.start();
+    while (persister.released(cacheKey) && timer.elapsed() < 3000)
+        QCoreApplication::processEvents(QEventLoop::AllEvents, 50);
+    ASSERT_FALSE(persister.released(cacheKey));
+}
+
+TEST_F(ut_DConfigServer, dirtyCache) {
+    DSGConfigResource resource(FILE_NAME, "", LocalPrefix);
+    ASSERT_TRUE(resource.load(APP_ID));
+    auto conn = resource.createConn(APP_ID, TestUid);
+    ASSERT_TRUE(conn);
+    const auto &cacheKey = ConfigSyncRequestCache::userKey(conn->key());
+
+    // the loaded caches are clean, neither the global nor the user cache is written.
+    auto skipped = resource.skippedWrites();
+    resource.save(APP_ID);
+    ASSERT_EQ(resource.skippedWrites(), skipped + 2);
+
+    conn->setValue("canExit", QDBusVariant{false});
+    ASSERT_TRUE(resource.isDirty(cacheKey));
+    skipped = resource.skippedWrites();
+    resource.save(APP_ID);
+    ASSERT_FALSE(resource.isDirty(cacheKey));
+    ASSERT_EQ(resource.skippedWrites(), skipped + 1);
+
+    // the content is the same as the saved one after changing back.
+    conn->setValue("canExit", QDBusVariant{true});
+    conn->setValue("canExit", QDBusVariant{false});
+    ASSERT_TRUE(resource.isDirty(cacheKey));
+    skipped = resource.skippedWrites();
+    resource.save(APP_ID);
+    ASSERT_EQ(resource.skippedWrites(), skipped + 2);
+}
+
+TEST_F(ut_DConfigServer, flushAll) {
+    auto path = server->acquireManagerV2(TestUid, APP_ID, FILE_NAME, QString("")).path();
+    auto resource = server->resourceObject(getGenericResourceKey(path));
+    ASSERT_TRUE(resource);
+    auto conn = resource->getConn(APP_ID, TestUid);
+    ASSERT_TRUE(conn);
+    ASSERT_EQ(resource->durability(getResourceKey(conn->key())), ConfigSyncRequestCache::Normal);
+
+    // the change is in the journal until the deadline, flushAll saves it at once.
+    conn->setValue("canExit", QDBusVariant{false});
+    ASSERT_FALSE(resource->journal().isEmpty());
+    server->flushAll();
+    ASSERT_FALSE(resource->isDirty(ConfigSyncRequestCache::userKey(conn->key())));
+
+    DConfigFile file(APP_ID, FILE_NAME, "");
+    ASSERT_TRUE(file.load(LocalPrefix));
+    std::unique_ptr<DConfigCache> cache(file.createUserCache(TestUid));
+    cache->setCachePathPrefix(configPrefixPath() + QString("/%1").arg(TestUid));
+    ASSERT_TRUE(cache->load(LocalPrefix));
+    ASSERT_EQ(cache->value("canExit"), QVariant(false));
+}
+
+TEST_F(ut_DConfigServer, compactJournalFollowUp) {
+    DSGConfigPersister persister;
+    DSGConfigResource resource(FILE_NAME, "", LocalPrefix);
+    resource.setPersister(&persister);
+    ASSERT_TRUE(resource.load(APP_ID));
+    auto conn = resource.createConn(APP_ID, TestUid);
+    ASSERT_TRUE(conn);
+    conn->setValue("key2", QDBusVariant{QString("first")});
+
+    // the change appended while compacting is folded by the follow-up compaction.
+    persister.beginBatch();
+    resource.compactJournal();
+    conn->setValue("key2", QDBusVariant{QString("second")});
+    std::optional<bool> saved;
+    resource.compactJournal([&saved](bool result) {
+        saved = result;
+    });
+    ASSERT_FALSE(saved);
+    persister.endBatch();
+
+    QElapsedTimer timer;
+    timer.start();
+    while (!saved && timer.elapsed() < 3000)
+        QCoreApplication::processEvents(QEventLoop::AllEvents, 50);
+    ASSERT_TRUE(saved.value_or(false));
+    ASSERT_TRUE(resource.journal().isEmpty());
+
+    DConfigFile file(APP_ID, FILE_NAME, "");
+    ASSERT_TRUE(file.load(LocalPrefix));
+    std::unique_ptr<DConfigCache> cache(file.createUserCache(TestUid));
+    cache->setCachePathPrefix(configPrefixPath() + QString("/%1").arg(TestUid));
+    ASSERT_TRUE(cache->load(LocalPrefix));
+    ASSERT_EQ(cache->value("key2").toString(), QString("second"));
+}
+
 TEST_F(ut_DConfigServer, metaPathToConfigureId) {
     QStringList appPaths {
         "/usr/share/dsg/configs/example.json",
@@ -163,6 +669,22 @@ TEST_F(ut_DConfigServer, metaPathToConfigureId) {
         const auto configureId = getMetaConfigureId(path);
         ASSERT_FALSE(configureId.isInValid());
     }
+
+    const auto configureId = getMetaConfigureId("/usr/share/dsg/configs/dconfig-example/a/b/example.json");
+    ASSERT_EQ(configureId.appid, "dconfig-example");
+    ASSERT_EQ(configureId.subpath, "a/b");
+    ASSERT_EQ(configureId.resource, "example");
+
+    QStringList invalidPaths {
+        "/usr/share/dsg/configs/overrides/example/a.json",
+        "/usr/share/dsg/configs/dconfig-example/example.txt",
+        "/usr/share/dsg/configs/dconfig-example/.json",
+        "/usr/share/dsg/configs/dconfig+example/example.json",
+        "/usr/share/dsg/example.json"
+    };
+    for (auto path : invalidPaths) {
+        ASSERT_TRUE(getMetaConfigureId(path).isInValid()) << qPrintable(path);
+    }
 }
 
 TEST_F(ut_DConfigServer, overridePathToConfigureId) {
@@ -180,6 +702,29 @@ TEST_F(ut_DConfigServer, overridePathToConfigureId) {
         const auto configureId = getOverrideConfigureId(path);
         ASSERT_FALSE(configureId.isInValid());
     }
+
+    auto configureId = getOverrideConfigureId("/etc/dsg/configs/overrides/dconfig-example/example/a/b/a.json");
+    ASSERT_EQ(configureId.appid, "dconfig-example");
+    ASSERT_EQ(configureId.resource, "example");
+    ASSERT_EQ(configureId.subpath, "a/b");
+    configureId = getOverrideConfigureId("/etc/dsg/configs/overrides/example/a.json");
+    ASSERT_TRUE(configureId.appid.isEmpty());
+    ASSERT_EQ(configureId.resource, "example");
+
+    ASSERT_TRUE(getOverrideConfigureId("/etc/dsg/configs/overrides/a.json").isInValid());
+    ASSERT_TRUE(getOverrideConfigureId("/usr/share/dsg/configs/example/a.json").isInValid());
+}
+
+TEST_F(ut_DConfigServer, configurePathTrie) {
+    DSGConfigPathTrie trie;
+    trie.setRoots({"/usr/share/dsg/configs", "/etc/dsg/configs/overrides/"});
+    ASSERT_TRUE(trie.contains("/usr/share/dsg/configs"));
+    ASSERT_TRUE(trie.contains("/usr/share/dsg/configs/dconfig-example/example.json"));
+    ASSERT_TRUE(trie.contains("/etc/dsg/configs/overrides/example/a.json"));
+    ASSERT_FALSE(trie.contains("/etc/dsg/configs/example.json"));
+    ASSERT_FALSE(trie.contains("/usr/share/dsg/configs2/example.json"));
+    ASSERT_FALSE(trie.contains("/usr/share"));
+    ASSERT_FALSE(trie.contains("usr/share/dsg/configs/example.json"));
 }
 
 TEST_F(ut_DConfigServer, acquireManagerGeneric) {
@@ -284,6 +829,27 @@ TEST_F(ut_DConfigServer, removeUserDataMultipleResources) {
     }
 }
 
+TEST_F(ut_DConfigServer, removeUserDataJournal) {
+    const uint testUid = 1004;
+    const auto path = server->acquireManagerV2(testUid, APP_ID, FILE_NAME, QString("")).path();
+    server->acquireManagerV2(TestUid, APP_ID, FILE_NAME, QString(""));
+    auto resource = server->resourceObject(getGenericResourceKey(path));
+    ASSERT_TRUE(resource);
+    auto conn = resource->getConn(APP_ID, testUid);
+    ASSERT_TRUE(conn);
+    conn->setValue("canExit", QDBusVariant{false});
+    conn = resource->getConn(APP_ID, TestUid);
+    ASSERT_TRUE(conn);
+    conn->setValue("canExit", QDBusVariant{false});
+    ASSERT_EQ(resource->journal().read().size(), 2);
+
+    // the records of the removed user can't recreate its cache files.
+    server->removeUserData(testUid);
+    const auto &records = resource->journal().read();
+    ASSERT_EQ(records.size(), 1);
+    ASSERT_EQ(records.first().uid, static_cast<uint>(TestUid));
+}
+
 TEST_F(ut_DConfigServer, removeUserDataEdgeCases) {
     // 测试边界情况
     